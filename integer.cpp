@@ -1,10 +1,17 @@
 ﻿#include"integer.h"
+#include"integer_kernel.h"
 #include<assert.h>
 #include<algorithm>
+#include<array>
+#include<bit>
+#include<cmath>
+#include<cstdint>
+#include<vector>
 
 namespace C163q {
 
-	integer::integer(const ::std::string& num) {
+	integer::integer(const ::std::string& num, const unsigned base) {
+		if (base < 2 || base > 36) throw ::std::invalid_argument("Invalid base.");
 		::std::string::const_iterator it = num.cbegin();
 		bool tmp_neg = false;
 		if (*it == '+') {
@@ -15,45 +22,32 @@ namespace C163q {
 			tmp_neg = true;
 			++it;
 		}
-		try {
-			for (; it != num.cend(); ++it) {
-				if (*it < '0' || *it > '9') throw ::std::invalid_argument("Invalid number.");
-				operator=(abs_mult_unit(10U));
-				operator+=(*it - '0');
-			}
-			negative = tmp_neg;
-			normalize();
-		}
-		catch (...) {
-			clear();
-			throw;
+		if (::std::any_of(it, num.cend(), [base](const char c) { return kernel::digit_value(c) >= base; })) {
+			throw ::std::invalid_argument("Invalid number.");
 		}
+		assign_digits(num.data() + (it - num.cbegin()), static_cast<size_t>(num.cend() - it), base);
+		negative = tmp_neg;
+		normalize();
+	}
+
+	void integer::assign_digits(const char* first, const size_t len, const unsigned base) {
+		// 先按上界分配空间, 再整体解析, 避免逐位乘base带来的重复分配
+		resize(kernel::from_chars_length(len, base));
+		resize(kernel::from_chars(data(), first, len, base));
 	}
 
 	integer& integer::abs_add(const integer& other) {
-		reserve(::std::max(size(), other.size()) + 1);	// 预留空间,最多会有这么多位
-		double_unit_t unit_add{};
-		unit_t advance{};		// 存储进位
-		size_t i{};
-		for (; i < ::std::min(size(), other.size()); ++i) {
-			unit_add = static_cast<double_unit_t>(operator[](i)) + other[i] + advance;
-			advance = high_bit(unit_add);
-			operator[](i) = unit_add;		// 高位用于进位,低位即为结果
-		}
-		while (i < size()) {		// size() > other.size()时
-			unit_add = static_cast<double_unit_t>(operator[](i)) + advance;
-			advance = high_bit(unit_add);
-			operator[](i) = unit_add;
-			++i;
-		}
-		while (i < other.size()) {
-			unit_add = static_cast<double_unit_t>(other[i]) + advance;
-			advance = high_bit(unit_add);
-			push_back(unit_add);
-			++i;
-		}
-		push_back(advance);
-		normalize();
+		const size_t n = size();
+		const size_t m = other.size();
+		unit_t carry{};
+		if (n >= m) {
+			carry = kernel::add(data(), data(), n, other.data(), m);
+		}
+		else {
+			resize(m);	// 此时other不是*this
+			carry = kernel::add(data(), other.data(), m, data(), n);
+		}
+		if (carry) push_back(carry);
 		return *this;
 	}
 
@@ -61,33 +55,7 @@ namespace C163q {
 #if _DEBUG
 		assert(container::operator>=(other));	// 该减法不能求出负数
 #endif
-		unit_t unit_sub{};
-		unit_t borrow{};	// 借位
-		size_t i = 0;
-		for (; i < other.size(); ++i) {
-			if (operator[](i) < other[i] + borrow) {
-				unit_sub = low_bit(unit_division + operator[](i) - other[i] - borrow);
-				operator[](i) = unit_sub;
-				borrow = 1;
-			}
-			else {
-				unit_sub = operator[](i) - other[i] - borrow;
-				operator[](i) = unit_sub;
-				borrow = 0;
-			}
-		}
-		while (i < size()) {
-			if (operator[](i) < borrow) {
-				unit_sub = low_bit(unit_division + operator[](i) - borrow);
-				operator[](i) = unit_sub;
-				borrow = 1;
-			}
-			else {
-				unit_sub = operator[](i) - borrow;
-				operator[](i) = unit_sub;
-				borrow = 0;
-			}
-		}
+		kernel::sub(data(), data(), size(), other.data(), other.size());
 		normalize();
 		return *this;
 	}
@@ -96,23 +64,87 @@ namespace C163q {
 		if (container::operator>=(other)) {
 			return abs_sub_abs(other);
 		}
-		integer tmp(other);
-		tmp.abs_sub_abs(*this);
-		tmp.negative = !negative;
-		operator=(::std::move(tmp));
+		// |lhs| < |rhs|: 在*this上计算rhs - lhs, 不构造临时对象
+		const size_t old_size = size();
+		resize(other.size());
+		kernel::sub(data(), other.data(), other.size(), data(), old_size);
+		negative = !negative;
+		normalize();
 		return *this;
 	}
 
 	[[nodiscard]] integer integer::abs_mult(const integer& other) const {
-		integer ret;
-		for (size_t i = 0; i < other.size(); ++i) {
-			integer&& res = abs_mult_unit(other[i]);
-			res.insert(res.begin(), i, 0);
-			ret += res;
+		integer ret(container_base_t(size() + other.size()));
+		if (size() >= other.size()) {
+			kernel::mul(ret.data(), data(), size(), other.data(), other.size());
 		}
+		else {
+			kernel::mul(ret.data(), other.data(), other.size(), data(), size());
+		}
+		ret.normalize();
 		return ret;
 	}
 
+	void integer::abs_mult_assign(const integer& other) {
+#if _DEBUG
+		assert(!is_zero() && !other.is_zero());
+#endif
+		const size_t n = size();
+		const size_t m = other.size();
+		if (m == 1) {
+			const unit_t carry = kernel::mul_1(data(), data(), n, other[0]);
+			if (carry) push_back(carry);
+			return;
+		}
+		// 乘法内核要求输出与输入不重叠, 先写入临时缓冲区, 再复制回已有的存储
+		const kernel::scratch_buffer<unit_t> prod(n + m);
+		if (this == ::std::addressof(other)) {
+			kernel::sqr(prod.data(), data(), n);
+		}
+		else if (n >= m) {
+			kernel::mul(prod.data(), data(), n, other.data(), m);
+		}
+		else {
+			kernel::mul(prod.data(), other.data(), m, data(), n);
+		}
+		resize(n + m);
+		::std::copy(prod.data(), prod.data() + n + m, data());
+		normalize();
+	}
+
+	void integer::abs_divrem_assign(const integer& other, const bool quotient) {
+#if _DEBUG
+		assert(!other.is_zero());
+#endif
+		if (container::operator<(other)) {
+			if (quotient) clear();
+			return;
+		}
+		const size_t n = size();
+		const size_t m = other.size();
+		if (m == 1) {
+			const unit_t rem = kernel::divrem_1(data(), data(), n, other[0]);
+			if (!quotient) {
+				clear();
+				push_back(rem);
+			}
+			normalize();
+			return;
+		}
+		const kernel::scratch_buffer<unit_t> quot(n - m + 1);
+		const kernel::scratch_buffer<unit_t> rem(m);
+		kernel::divrem(quot.data(), rem.data(), data(), n, other.data(), m);
+		if (quotient) {
+			::std::copy(quot.data(), quot.data() + n - m + 1, data());
+			resize(n - m + 1);
+		}
+		else {
+			::std::copy(rem.data(), rem.data() + m, data());
+			resize(m);
+		}
+		normalize();
+	}
+
 	[[nodiscard]] integer integer::abs_mult_unit(const unit_t& other) const {
 		integer ret;
 		ret.reserve(size() + 1);
@@ -127,33 +159,47 @@ namespace C163q {
 		return ret;
 	}
 
-	[[nodiscard]] ::std::pair<integer, integer> integer::make_div(const integer& other) const {
-		size_t rhs_bit_width = static_cast<size_t>(other.bit_cend() - other.bit_cbegin());	// 获取other位宽度
-		const_bit_iterator my_bit_end = bit_cend();
-		const_bit_iterator tmp_it = my_bit_end - rhs_bit_width;	// 指向准备计算的被除位置
-		integer im_int;
-		im_int.reserve(my_bit_end.get_base_it() - tmp_it.get_base_it() + 1);
-		for (const_iterator it = tmp_it.get_base_it(); it != my_bit_end.get_base_it(); ++it) {	// 拷贝被除数部分
-			im_int.push_back(*it);
-		}
-		if (my_bit_end.get_pos()) { im_int.push_back(*(my_bit_end.get_base_it())); }
-		im_int >>= tmp_it.get_pos();
-		integer ret(container::container_base_t(size() - other.size() + 1, 0));
-		bit_reverse_iterator res_apply = ::std::make_reverse_iterator(++(ret.bit_begin() + (tmp_it - bit_cbegin())));	// 商是逐bit求出的
-		do {
-			if (im_int.container::operator>=(other)) {	// (逐bit)结果只有1和0
-				*res_apply = true;
-				im_int.abs_sub_abs(other);
-			}
-			++res_apply;
-			if (res_apply != ret.bit_rend()) {	// 阻止越界访问
-				im_int <<= 1;
-				*(im_int.bit_begin()) = *--tmp_it;
+	void integer::mul_accumulate(const unit_t* a, const size_t an, const unit_t* b, const size_t bn, const bool product_negative) {
+		if (is_zero() || negative == product_negative) {
+			negative = product_negative;
+			resize(::std::max(size(), an + bn) + 1);
+			kernel::addmul(data(), size(), a, an, b, bn);
+		}
+		else {
+			resize(::std::max(size(), an + bn));
+			if (kernel::submul(data(), size(), a, an, b, bn)) {
+				// 积的绝对值更大, 差以补码形式留在*this中: 取反加一得到绝对值, 并翻转符号
+				::std::transform(begin(), end(), begin(), [](const unit_t x) { return static_cast<unit_t>(~x); });
+				kernel::add_1(data(), data(), size(), 1);
+				negative = !negative;
 			}
-		} while (res_apply != ret.bit_rend());
-		ret.normalize();
-		im_int.normalize();
-		return { ret, im_int };	// 左商,右余数
+		}
+		normalize();
+	}
+
+	void integer::fused_mul(const integer& a, const integer& b, const bool product_negative) {
+		if (a.is_zero() || b.is_zero()) return;
+		const integer& x = a.size() >= b.size() ? a : b;
+		const integer& y = a.size() >= b.size() ? b : a;
+		if (this != ::std::addressof(a) && this != ::std::addressof(b)) {
+			mul_accumulate(x.data(), x.size(), y.data(), y.size(), product_negative);
+			return;
+		}
+		// 操作数与*this共用存储, resize会使其失效, 先复制一份
+		const kernel::scratch_buffer<unit_t> copy(size());
+		::std::copy(begin(), end(), copy.data());
+		const unit_t* const xp = this == ::std::addressof(x) ? copy.data() : x.data();
+		const unit_t* const yp = this == ::std::addressof(y) ? copy.data() : y.data();
+		mul_accumulate(xp, x.size(), yp, y.size(), product_negative);
+	}
+
+	[[nodiscard]] ::std::pair<integer, integer> integer::make_div(const integer& other) const {
+		integer quot(container_base_t(size() - other.size() + 1));
+		integer rem(container_base_t(other.size()));
+		kernel::divrem(quot.data(), rem.data(), data(), size(), other.data(), other.size());
+		quot.normalize();
+		rem.normalize();
+		return { ::std::move(quot), ::std::move(rem) };	// 左商,右余数
 	}
 	
 	[[nodiscard]] ::std::pair<integer, integer::unit_t> integer::make_div_unit(const unit_t& rhs) const {
@@ -169,7 +215,7 @@ namespace C163q {
 		return { ret, static_cast<unit_t>(divided_v) };
 	}
 
-	[[nodiscard]] integer integer::operator+(const integer& other) const {
+	[[nodiscard]] integer integer::operator+(const integer& other) const& {
 		if (negative == other.negative) {
 			integer ret(*this);
 			ret.abs_add(other);
@@ -184,7 +230,7 @@ namespace C163q {
 		return ret;
 	}
 
-	[[nodiscard]] integer integer::operator-(const integer& other) const {
+	[[nodiscard]] integer integer::operator-(const integer& other) const& {
 		if (negative == other.negative) {
 			integer ret(*this);
 			// 200 - 100 -> 100
@@ -199,7 +245,10 @@ namespace C163q {
 		return ret;
 	}
 
-	[[nodiscard]] integer integer::operator*(const integer& other) const {
+	[[nodiscard]] integer integer::operator*(const integer& other) const& {
+		if (this == ::std::addressof(other)) {
+			return square();
+		}
 		if (is_zero() || other.is_zero()) {
 			return {};
 		}
@@ -218,7 +267,26 @@ namespace C163q {
 		return ret;
 	}
 
-	[[nodiscard]] integer integer::operator/(const integer& other) const {
+	integer& integer::operator*=(const integer& other) {
+		if (is_zero() || other.is_zero()) {
+			set_zero();
+			return *this;
+		}
+		const bool neg = (negative != other.negative);
+		if (!other.is_one_abs()) abs_mult_assign(other);
+		negative = neg;
+		return *this;
+	}
+
+	[[nodiscard]] integer integer::square() const {
+		if (is_zero()) return {};
+		integer ret(container_base_t(2 * size()));
+		kernel::sqr(ret.data(), data(), size());
+		ret.normalize();
+		return ret;
+	}
+
+	[[nodiscard]] integer integer::operator/(const integer& other) const& {
 		if (other.is_zero()) throw ::std::domain_error("Divided by zero.");
 		if (is_zero()) return {};
 		if (other.is_one_abs()) return integer(container(*this), negative != other.negative);
@@ -228,7 +296,16 @@ namespace C163q {
 		return ret;
 	}
 
-	[[nodiscard]] integer integer::operator%(const integer& other) const {
+	integer& integer::operator/=(const integer& other) {
+		if (other.is_zero()) throw ::std::domain_error("Divided by zero.");
+		const bool neg = (negative != other.negative);
+		if (!other.is_one_abs()) abs_divrem_assign(other, true);
+		negative = neg;
+		normalize();
+		return *this;
+	}
+
+	[[nodiscard]] integer integer::operator%(const integer& other) const& {
 		if (other.is_zero()) throw ::std::domain_error("Moded by zero.");
 		if (is_zero()) return {};
 		if (other.is_one_abs()) return {};
@@ -238,42 +315,514 @@ namespace C163q {
 		return ret;
 	}
 
-	[[nodiscard]] ::std::string integer::ToString() const {
-		integer tmp(*this);
-		tmp.negative = false;
+	integer& integer::operator%=(const integer& other) {
+		if (other.is_zero()) throw ::std::domain_error("Moded by zero.");
+		const bool neg = (negative != other.negative);
+		if (other.is_one_abs()) clear();
+		else abs_divrem_assign(other, false);
+		negative = neg;
+		normalize();
+		return *this;
+	}
+
+	[[nodiscard]] ::std::string integer::ToString(const unsigned base) const {
+		if (base < 2 || base > 36) throw ::std::invalid_argument("Invalid base.");
 		if (is_zero()) return "0";
-		::std::string ret;
-		while (!tmp.is_zero()) {
-			auto&& div_mod = tmp.make_div_unit(10U);
-			ret.push_back(div_mod.second + '0');
-			tmp = ::std::move(div_mod.first);
-		}
-		if (negative) ret.push_back('-');
-		::std::reverse(ret.begin(), ret.end());
+		::std::string ret(kernel::to_chars_length(data(), size(), base) + negative, '-');
+		const size_t len = kernel::to_chars(ret.data() + negative, data(), size(), base);
+		ret.resize(len + negative);
 		return ret;
 	}
 
 
+	/// @brief 半GCD累积的Euclid步骤之积M = Q(q1) * Q(q2) * ..., Q(q) = [[q, 1], [1, 0]], 满足(a, b) = M * (α, β).
+	/// 元素均非负, det(M) = (-1)^k, odd记录k的奇偶
+	struct integer::hgcd_matrix {
+		integer m00{ 1 };
+		integer m01;
+		integer m10;
+		integer m11{ 1 };
+		bool odd{};
+
+		[[nodiscard]] bool is_identity() const noexcept {
+			return m01.is_zero() && m10.is_zero();
+		}
+
+		// M ← M * Q(q)
+		void push(const integer& q) {
+			addmul(m01, m00, q);
+			::std::swap(m00, m01);
+			addmul(m11, m10, q);
+			::std::swap(m10, m11);
+			odd = !odd;
+		}
+
+		// M ← M * L, L为Lehmer矩阵对应的步骤之积[[lm.m11, lm.m01], [lm.m10, lm.m00]]
+		void push(const kernel::lehmer_matrix& lm) {
+			const auto row = [&lm](integer& x, integer& y) {
+				integer nx(x * integer(lm.m11));
+				addmul_unit(nx, y, lm.m10);
+				integer ny(x * integer(lm.m01));
+				addmul_unit(ny, y, lm.m00);
+				x = ::std::move(nx);
+				y = ::std::move(ny);
+			};
+			row(m00, m01);
+			row(m10, m11);
+			odd = odd != lm.odd;
+		}
+
+		// M ← M * N
+		void push(const hgcd_matrix& n) {
+			const auto row = [&n](integer& x, integer& y) {
+				integer nx(x * n.m00);
+				addmul(nx, y, n.m10);
+				integer ny(x * n.m01);
+				addmul(ny, y, n.m11);
+				x = ::std::move(nx);
+				y = ::std::move(ny);
+			};
+			row(m00, m01);
+			row(m10, m11);
+			odd = odd != n.odd;
+		}
+
+		// (x, y) ← M^-1 * (x, y) = det(M) * (m11 * x - m01 * y, m00 * y - m10 * x), x与y可以为负数
+		void apply_inverse(integer& x, integer& y) const {
+			integer nx(x * m11);
+			submul(nx, y, m01);
+			integer ny(y * m00);
+			submul(ny, x, m10);
+			if (odd) {
+				if (!nx.is_zero()) nx.negative = !nx.negative;
+				if (!ny.is_zero()) ny.negative = !ny.negative;
+			}
+			x = ::std::move(nx);
+			y = ::std::move(ny);
+		}
+	};
+
+	namespace {
+		// a > b时, Euclid算法停在(a, b)不会越过2^s: b >= 2^s且a - b >= 2^s. 这样的位置构成余数序列的前缀
+		[[nodiscard]] bool hgcd_safe(const integer& a, const integer& b, const size_t s) {
+			return b.bit_length() > s && (a - b).bit_length() > s;
+		}
+	}
+
+	void integer::hgcd_basecase(integer& a, integer& b, const size_t s, hgcd_matrix* m) {
+		for (;;) {
+			const size_t n = a.size();
+			kernel::lehmer_matrix lm;
+			if (n > 2 && b.size() > 1 && kernel::lehmer_step(lm, a.data(), n, b.data(), b.size())) {
+				integer na(container_base(n + 1));
+				integer nb(container_base(n + 1));
+				size_t na_size{}, nb_size{};
+				b.resize(n);
+				kernel::lehmer_apply(na.data(), na_size, nb.data(), nb_size, lm, a.data(), b.data(), n);
+				b.normalize();
+				na.resize(na_size);
+				nb.resize(nb_size);
+				// 整个矩阵越过了2^s时改为逐步进行
+				if (hgcd_safe(na, nb, s)) {
+					a = ::std::move(na);
+					b = ::std::move(nb);
+					if (m) m->push(lm);
+					continue;
+				}
+			}
+			auto [quot, rem] = a.make_div(b);
+			if (!hgcd_safe(b, rem, s)) return;
+			a = ::std::move(b);
+			b = ::std::move(rem);
+			if (m) m->push(quot);
+		}
+	}
+
+	// 截断引理: 设a = 2^p * a0 + a1, b = 2^p * b0 + b1(a1, b1 < 2^p), M把(a0, b0)约化到关于s0安全的位置且
+	// s0 >= (bit_length(a0) + 2) / 2, 则M的元素小于2^(s0-2), M^-1 * (a, b)与2^p * M^-1 * (a0, b0)之差小于2^(p+s0-2),
+	// 因而M^-1 * (a, b)关于p + s0 - 1安全, M也是(a, b)的Euclid步骤
+	void integer::hgcd(integer& a, integer& b, const size_t s, hgcd_matrix* m) {
+		if (!hgcd_safe(a, b, s)) return;
+		const size_t n = a.bit_length();
+		if (n - s <= kernel::hgcd_basecase_threshold * unit_bit) {
+			hgcd_basecase(a, b, s, m);
+			return;
+		}
+		// 第一次递归: 只看高n - s位, 约去其中的一半
+		{
+			integer a0(a >> s);
+			integer b0(b >> s);
+			hgcd_matrix m1;
+			hgcd(a0, b0, (n - s + 3) / 2, &m1);
+			if (!m1.is_identity()) {
+				m1.apply_inverse(a, b);
+				if (m) m->push(m1);
+			}
+		}
+		// 一次除法, 保证即使递归没有进展也能前进
+		{
+			auto [quot, rem] = a.make_div(b);
+			if (!hgcd_safe(b, rem, s)) return;
+			a = ::std::move(b);
+			b = ::std::move(rem);
+			if (m) m->push(quot);
+		}
+		// 第二次递归: 截去低p位后约化到s - p + 1, 结果关于s安全
+		const size_t n2 = a.bit_length();
+		const size_t p = 2 * s > n2 ? 2 * s - n2 : 0;
+		if (p) {
+			integer a0(a >> p);
+			integer b0(b >> p);
+			hgcd_matrix m2;
+			hgcd(a0, b0, s - p + 1, &m2);
+			if (!m2.is_identity()) {
+				m2.apply_inverse(a, b);
+				if (m) m->push(m2);
+			}
+		}
+		else {
+			hgcd(a, b, s, m);
+		}
+		// 截断约化可能在离2^s还有几步时停下
+		hgcd_basecase(a, b, s, m);
+	}
+
 	[[nodiscard]] integer gcd(const integer& first, const integer& second) {
 		if (first.is_zero() || second.is_zero()) return {};
-		if (first == second) return first.abs();
-		integer m;
-		integer n;
-		if (first.integer::container::operator>=(second)) {
-			m = first.abs();
-			n = second.abs();
+		if (::std::min(first.size(), second.size()) < kernel::gcd_dc_threshold) {
+			integer ret(integer::container_base(::std::min(first.size(), second.size())));
+			ret.resize(kernel::gcd(ret.data(), first.data(), first.size(), second.data(), second.size()));
+			return ret;
 		}
-		else {
-			m = second.abs();
-			n = first.abs();
+		integer u(first.abs());
+		integer v(second.abs());
+		if (u.integer::container::operator<(v)) ::std::swap(u, v);
+		// 每轮用半GCD把位数约去约一半, 再做一次除法
+		while (v.size() >= kernel::gcd_dc_threshold) {
+			integer::hgcd(u, v, u.bit_length() / 2 + 1, nullptr);
+			integer rem(u % v);
+			u = ::std::move(v);
+			v = ::std::move(rem);
+		}
+		return v.is_zero() ? u : gcd(u, v);
+	}
+
+	namespace {
+		// 把Lehmer余因子矩阵作用于(x0, x1), 与`kernel::lehmer_apply`相同但允许x0, x1为负数
+		void apply_cofactors(integer& x0, integer& x1, const kernel::lehmer_matrix& m) {
+			integer n0(x0 * integer(m.m00));
+			submul(n0, x1, integer(m.m01));
+			integer n1(x1 * integer(m.m11));
+			submul(n1, x0, integer(m.m10));
+			if (m.odd) {
+				if (!n0.is_zero()) (void)n0.make_opposite();
+				if (!n1.is_zero()) (void)n1.make_opposite();
+			}
+			x0 = ::std::move(n0);
+			x1 = ::std::move(n1);
 		}
-		integer r(m % n);
-		while (r) {
-			m = ::std::move(n);
-			n = ::std::move(r);
-			r = ::std::move(m % n);
+	}
+
+	[[nodiscard]] ::std::tuple<integer, integer, integer> xgcd(const integer& first, const integer& second) {
+		// 始终保持u = s0 * |first| + t0 * |second|, v = s1 * |first| + t1 * |second|
+		integer u(first.abs());
+		integer v(second.abs());
+		integer s0(1), s1, t0, t1(1);
+		if (u.integer::container::operator<(v)) {
+			::std::swap(u, v);
+			::std::swap(s0, s1);
+			::std::swap(t0, t1);
+		}
+		while (!v.is_zero()) {
+			if (v.size() >= kernel::gcd_dc_threshold) {
+				integer::hgcd_matrix m;
+				integer::hgcd(u, v, u.bit_length() / 2 + 1, &m);
+				if (!m.is_identity()) {
+					m.apply_inverse(s0, s1);
+					m.apply_inverse(t0, t1);
+				}
+			}
+			else {
+				kernel::lehmer_matrix m;
+				if (u.size() > 2 && v.size() > 1 && kernel::lehmer_step(m, u.data(), u.size(), v.data(), v.size())) {
+					apply_cofactors(u, v, m);
+					apply_cofactors(s0, s1, m);
+					apply_cofactors(t0, t1, m);
+					continue;
+				}
+			}
+			auto [quot, rem] = u.make_div(v);
+			u = ::std::move(v);
+			v = ::std::move(rem);
+			submul(s0, quot, s1);
+			::std::swap(s0, s1);
+			submul(t0, quot, t1);
+			::std::swap(t0, t1);
+		}
+		if (first.negative && !s0.is_zero()) (void)s0.make_opposite();
+		if (second.negative && !t0.is_zero()) (void)t0.make_opposite();
+		return { ::std::move(u), ::std::move(s0), ::std::move(t0) };
+	}
+
+	[[nodiscard]] integer pow(const integer& base, const unsigned long exp) {
+		if (exp == 0) return integer(1);
+		if (base.is_zero()) return {};
+		const size_t zeros = base.count_trailing_zeros();
+		integer ret(1);
+		if (zeros + 1 != base.bit_length()) {
+			integer odd(base.abs());
+			odd >>= zeros;
+			const size_t on = odd.size();
+			// 结果不超过bit_length(odd) * exp位, 两个缓冲区轮流存放平方与乘积, 不再分配内存
+			const size_t cap = (odd.bit_length() * exp + kernel::unit_bit - 1) / kernel::unit_bit + 1;
+			ret = integer(integer::container_base(cap));
+			const kernel::scratch_buffer<kernel::unit_t> buffer(cap);
+			kernel::unit_t* cur = ret.data();
+			kernel::unit_t* other = buffer.data();
+			::std::copy_n(odd.data(), on, cur);
+			size_t n = on;
+			for (int i{ static_cast<int>(::std::bit_width(exp)) - 1 }; i--;) {
+				kernel::sqr(other, cur, n);
+				n *= 2;
+				if (!other[n - 1]) --n;
+				if ((exp >> i) & 1) {
+					kernel::mul(cur, other, n, odd.data(), on);
+					n += on;
+					if (!cur[n - 1]) --n;
+				}
+				else {
+					::std::swap(cur, other);
+				}
+			}
+			if (cur != ret.data()) ::std::copy_n(cur, n, ret.data());
+			ret.resize(n);
+		}
+		ret <<= zeros * exp;
+		ret.negative = base.negative && (exp & 1);
+		return ret;
+	}
+
+	namespace {
+		// 根不超过该位数时直接由对数估计
+		constexpr size_t root_estimate_bits{ 40 };
+
+		// log2(a[0..n)), 只用最高的若干limb(最高limb之外至少64位). Note: a[n-1] != 0
+		[[nodiscard]] double log2_limbs(const kernel::unit_t* a, const size_t n) noexcept {
+			const size_t used = ::std::min<size_t>(n, 1 + 64 / kernel::unit_bit);
+			double top{};
+			for (size_t i{ n }; i-- > n - used;) top = ::std::ldexp(top, kernel::unit_bit) + static_cast<double>(a[i]);
+			return ::std::log2(top) + static_cast<double>((n - used) * kernel::unit_bit);
+		}
+
+		// 2^(log2x / k)四舍五入. 根不超过`root_estimate_bits`位时误差远小于1
+		[[nodiscard]] unsigned long long root_estimate(const double log2x, const unsigned long k) noexcept {
+			return static_cast<unsigned long long>(::std::llround(::std::exp2(log2x / static_cast<double>(k))));
+		}
+
+		// 从y >= floor(x^(1/k))开始做整数Newton迭代, y单调下降, 不再变小时即为floor(x^(1/k)). Note: x > 0, k >= 2
+		void root_newton(integer& y, const integer& x, const unsigned long k) {
+			for (;;) {
+				integer t(x / (k == 2 ? y : pow(y, k - 1)));
+				addmul(t, y, integer(k - 1));
+				t /= integer(k);
+				if (!(t < y)) return;
+				y = ::std::move(t);
+			}
+		}
+
+		// 2 <= n < 2^32时n是否为素数
+		[[nodiscard]] bool is_small_prime(const ::std::uint64_t n) noexcept {
+			if (n < 4) return n > 1;
+			if (!(n & 1)) return false;
+			for (::std::uint64_t d{ 3 }; d * d <= n; d += 2) {
+				if (n % d == 0) return false;
+			}
+			return true;
 		}
-		return n;
+
+		// b^e mod q. Note: q < 2^32
+		[[nodiscard]] ::std::uint64_t powmod_small(::std::uint64_t b, ::std::uint64_t e, const ::std::uint64_t q) noexcept {
+			::std::uint64_t ret{ 1 };
+			for (b %= q; e; e >>= 1) {
+				if (e & 1) ret = ret * b % q;
+				b = b * b % q;
+			}
+			return ret;
+		}
+
+		// p为奇素数. 取4个q ≡ 1 (mod p)的小素数, a是p次幂时a^((q-1)/p) ≡ 0或1 (mod q), 非p次幂约只有p^-4的概率通过
+		[[nodiscard]] bool power_residue_filter(const kernel::unit_t* a, const size_t n, const unsigned long p) noexcept {
+			unsigned found{};
+			for (::std::uint64_t q{ 2 * static_cast<::std::uint64_t>(p) + 1 }; found < 4 && q <= 0xFFFF'FFFFU; q += 2 * static_cast<::std::uint64_t>(p)) {
+				if (!is_small_prime(q)) continue;
+				++found;
+				const ::std::uint64_t r = kernel::mod_1(a, n, static_cast<kernel::unit_t>(q));
+				if (r && powmod_small(r, (q - 1) / p, q) != 1) return false;
+			}
+			return true;
+		}
+
+		template<unsigned M>
+		[[nodiscard]] constexpr ::std::array<bool, M> square_residues() noexcept {
+			::std::array<bool, M> ret{};
+			for (unsigned i{}; i < M; ++i) ret[i * i % M] = true;
+			return ret;
+		}
+
+		constexpr auto square_mod64 = square_residues<64>();
+		constexpr auto square_mod63 = square_residues<63>();
+		constexpr auto square_mod65 = square_residues<65>();
+		constexpr auto square_mod11 = square_residues<11>();
+	}
+
+	[[nodiscard]] integer iroot(const integer& value, const unsigned long k) {
+		if (k == 0) throw ::std::domain_error("Zeroth root.");
+		if (value.negative && !(k & 1)) throw ::std::domain_error("Even root of a negative number.");
+		if (k == 1 || value.is_zero() || value.is_one_abs()) return value;
+		const size_t bits = value.bit_length();
+		if (k >= bits) return integer(integer::container(kernel::unit_t{ 1 }), value.negative);	// 1 <= |value| < 2^k
+		integer abs_value;
+		if (value.negative) abs_value = value.abs();
+		const integer& x = value.negative ? abs_value : value;
+		// 每层把根的位数减半, 先对x的最高部分求根, 再把结果左移作为下一层的上界, 由Newton迭代修正.
+		// 每层只需常数次迭代, 总代价与最外层的一次迭代同阶
+		size_t shifts[64]{};
+		size_t levels{};
+		size_t total{};
+		for (size_t root_bits{ bits / k }; root_bits > root_estimate_bits; root_bits -= shifts[levels++]) {
+			shifts[levels] = root_bits / 2;
+			total += shifts[levels];
+		}
+		integer part(x >> (k * total));
+		integer ret(root_estimate(log2_limbs(part.data(), part.size()), k));
+		while (pow(ret, k) > part) --ret;
+		for (integer next(ret + 1); pow(next, k) <= part; ++next) ret = next;
+		while (levels--) {
+			total -= shifts[levels];
+			part = x >> (k * total);
+			++ret;
+			ret <<= shifts[levels];
+			root_newton(ret, part, k);
+		}
+		ret.negative = value.negative;
+		return ret;
+	}
+
+	[[nodiscard]] bool is_perfect_square(const integer& value) {
+		if (value.negative) return false;
+		if (value.is_zero()) return true;
+		// 非平方数通过这四个表的比例约为0.84%
+		if (!square_mod64[value.data()[0] & 63]) return false;
+		const kernel::unit_t r = kernel::mod_1(value.data(), value.size(), 63 * 65 * 11);
+		if (!square_mod63[r % 63] || !square_mod65[r % 65] || !square_mod11[r % 11]) return false;
+		return iroot(value, 2).square() == value;
+	}
+
+	[[nodiscard]] bool is_perfect_power(const integer& value) {
+		if (value.is_zero() || value.is_one_abs()) return true;
+		// value = ±2^zeros * odd是a^p时p | zeros且odd是p次幂
+		const size_t zeros = value.count_trailing_zeros();
+		if (zeros == 1) return false;
+		integer odd(value.abs());
+		odd >>= zeros;
+		// 负数只能是奇数次幂: -2^zeros要求zeros有奇因子
+		if (odd.is_one_abs()) return !value.negative || (zeros & (zeros - 1));
+		const size_t bits = odd.bit_length();
+		const double log2x = log2_limbs(odd.data(), odd.size());
+		// odd的根是不小于3的奇数, 所以p <= log3(odd)
+		const size_t max_p = static_cast<size_t>(log2x / ::std::log2(3.0)) + 1;
+		::std::vector<bool> composite(max_p + 1);
+		for (size_t p{ 2 }; p <= max_p; ++p) {
+			if (composite[p]) continue;
+			for (size_t j{ p * p }; j <= max_p; j += p) composite[j] = true;
+			if (zeros % p) continue;
+			if (p == 2) {
+				if (!value.negative && is_perfect_square(odd)) return true;
+				continue;
+			}
+			if (bits <= p * root_estimate_bits) {
+				// 候选根必须是奇数, 且其p次幂的最低limb与odd相同
+				const unsigned long long a = root_estimate(log2x, p);
+				if (a < 3 || !(a & 1)) continue;
+				kernel::unit_t low{ 1 };
+				kernel::unit_t b = static_cast<kernel::unit_t>(a);
+				for (size_t e{ p }; e; e >>= 1) {
+					if (e & 1) low *= b;
+					b *= b;
+				}
+				if (low != odd.data()[0]) continue;
+				if (pow(integer(a), p) == odd) return true;
+			}
+			else if (power_residue_filter(odd.data(), odd.size(), p) && pow(iroot(odd, p), p) == odd) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void addmul(integer& acc, const integer& a, const integer& b) {
+		acc.fused_mul(a, b, a.negative != b.negative);
+	}
+
+	void submul(integer& acc, const integer& a, const integer& b) {
+		acc.fused_mul(a, b, a.negative == b.negative);
+	}
+
+	void addmul_unit(integer& acc, const integer& a, const integer_container::unit_t b) {
+		if (a.is_zero() || !b) return;
+		if (::std::addressof(acc) != ::std::addressof(a)) {
+			acc.mul_accumulate(a.data(), a.size(), &b, 1, a.negative);
+			return;
+		}
+		const kernel::scratch_buffer<integer::unit_t> copy(a.size());
+		::std::copy(a.begin(), a.end(), copy.data());
+		acc.mul_accumulate(copy.data(), a.size(), &b, 1, a.negative);
+	}
+
+	[[nodiscard]] ::std::size_t to_chars_length(const integer& value, const int base) noexcept {
+#if _DEBUG
+		assert(base >= 2 && base <= 36);
+#endif
+		if (value.is_zero()) return 1;
+		return kernel::to_chars_length(value.data(), value.size(), static_cast<unsigned>(base)) + value.negative;
+	}
+
+	::std::to_chars_result to_chars(char* first, char* last, const integer& value, const int base) {
+#if _DEBUG
+		assert(base >= 2 && base <= 36);
+#endif
+		const size_t space = static_cast<size_t>(last - first);
+		const size_t bound = to_chars_length(value, base);
+		if (space >= bound) {
+			if (value.is_zero()) {
+				*first = '0';
+				return { first + 1, ::std::errc{} };
+			}
+			if (value.negative) *first++ = '-';
+			return { first + kernel::to_chars(first, value.data(), value.size(), static_cast<unsigned>(base)), ::std::errc{} };
+		}
+		if (!(base & (base - 1))) return { last, ::std::errc::value_too_large };	// 此时长度是精确的
+		// 上界超出了给定空间, 但实际长度可能放得下: 先写入临时空间再复制
+		const kernel::scratch_buffer<char> tmp(bound);
+		char* const buffer = tmp.data();
+		char* const end = to_chars(buffer, buffer + bound, value, base).ptr;
+		const size_t len = static_cast<size_t>(end - buffer);
+		if (len > space) return { last, ::std::errc::value_too_large };
+		return { ::std::copy(buffer, end, first), ::std::errc{} };
+	}
+
+	::std::from_chars_result from_chars(const char* first, const char* last, integer& value, const int base) {
+#if _DEBUG
+		assert(base >= 2 && base <= 36);
+#endif
+		const bool neg = first != last && *first == '-';
+		const char* const digits = first + neg;
+		const char* const end = ::std::find_if(digits, last, [base](const char c) { return kernel::digit_value(c) >= static_cast<unsigned>(base); });
+		if (end == digits) return { first, ::std::errc::invalid_argument };
+		value.assign_digits(digits, static_cast<size_t>(end - digits), static_cast<unsigned>(base));
+		value.negative = neg;
+		value.normalize();
+		return { end, ::std::errc{} };
 	}
 
 }
@@ -5,6 +5,9 @@
 #include<cstddef>
 #include<string>
 #include<cassert>
+#include<charconv>
+#include<system_error>
+#include<tuple>
 #include"integer_container.h"
 
 
@@ -12,8 +15,10 @@
 
 namespace C163q {
 	class rational_number;
+	class modular_context;
 	class integer : private integer_container {
 		friend rational_number;
+		friend modular_context;
 	public:
 		using container_base = integer_container::container_base_t;
 		using container = integer_container;
@@ -47,8 +52,9 @@ namespace C163q {
 		integer(const signed long long num) : container(static_cast<double_unit_t>(num < 0 ? -num : num)), negative(num < 0 ? true : false) {}
 		integer(const unsigned long long num) : container(static_cast<double_unit_t>(num)), negative() {}
 
-		explicit integer(const char* num) : integer(::std::string(num)) {}
-		explicit integer(const ::std::string& num);
+		// 按base进制解析, 可带'+'或'-'号. 数字可以是'0'-'9', 'a'-'z'或'A'-'Z'. Note: 2 <= base <= 36
+		explicit integer(const char* num, const unsigned base = 10) : integer(::std::string(num), base) {}
+		explicit integer(const ::std::string& num, const unsigned base = 10);
 
 		// 用`integer_container`构造`integer`,不指定符号将默认为正号.
 		explicit integer(const container& base) : container(base), negative(false) {}
@@ -67,7 +73,7 @@ namespace C163q {
 			return *this;
 		}
 
-		integer& operator=(integer&& other) noexcept {
+		integer& operator=(integer&& other) {
 			if (this == ::std::addressof(other)) return *this;
 			container::operator=(::std::move(other));
 			negative = ::std::exchange(other.negative, false);
@@ -124,6 +130,30 @@ namespace C163q {
 			return negative;
 		}
 
+		// 以下按位查询都作用于绝对值
+
+		// 二进制位数, 0的位数为0
+		[[nodiscard]] size_t bit_length() const noexcept {
+			return container::bit_length();
+		}
+
+		// 1的个数
+		[[nodiscard]] size_t popcount() const noexcept {
+			return container::popcount();
+		}
+
+		// 最低位起连续0的个数, 即能整除的2的最高次幂. 0返回0
+		[[nodiscard]] size_t count_trailing_zeros() const noexcept {
+			return container::count_trailing_zeros();
+		}
+
+		// 第pos位及更高位中最低的1的位置, 不存在时返回`integer::npos`
+		[[nodiscard]] size_t find_next_set_bit(const size_t pos) const noexcept {
+			return container::find_next_set_bit(pos);
+		}
+
+		using container::npos;
+
 		[[nodiscard]] bool is_positive() const noexcept {
 			return !negative && !is_zero();
 		}
@@ -167,24 +197,40 @@ namespace C163q {
 			return *this;
 		}
 
-		[[nodiscard]] integer operator>>(const size_t& bit) const {
+		[[nodiscard]] integer operator>>(const size_t& bit) const& {
 			return integer(container::operator>>(bit), negative);
 		}
 
+		// 左操作数为临时对象时直接在其上运算, 复用其存储(下同)
+		[[nodiscard]] integer operator>>(const size_t& bit)&& {
+			operator>>=(bit);
+			return ::std::move(*this);
+		}
+
 		integer& operator<<=(const size_t& bit) {
 			container::operator<<=(bit);
 			return *this;
 		}
 
-		[[nodiscard]] integer operator<<(const size_t& bit) const {
+		[[nodiscard]] integer operator<<(const size_t& bit) const& {
 			return integer(container::operator<<(bit), negative);
 		}
 
+		[[nodiscard]] integer operator<<(const size_t& bit)&& {
+			operator<<=(bit);
+			return ::std::move(*this);
+		}
+
 		// return lhs.abs() | rhs.abs() and lhs.is_negative() || rhs.is_negative()
-		[[nodiscard]] integer operator|(const integer& other) const {
+		[[nodiscard]] integer operator|(const integer& other) const& {
 			return integer(container::operator|(other), negative || other.negative);
 		}
 
+		[[nodiscard]] integer operator|(const integer& other)&& {
+			operator|=(other);
+			return ::std::move(*this);
+		}
+
 		integer& operator|=(const integer& other) {
 			container::operator|=(other);
 			negative = negative || other.negative;
@@ -192,10 +238,15 @@ namespace C163q {
 		}
 
 		// return lhs.abs() & lhs.abs() and lhs.is_negative() && rhs.is_negative()
-		[[nodiscard]] integer operator&(const integer& other) const {
+		[[nodiscard]] integer operator&(const integer& other) const& {
 			return integer(container::operator&(other), negative && other.negative);
 		}
 
+		[[nodiscard]] integer operator&(const integer& other)&& {
+			operator&=(other);
+			return ::std::move(*this);
+		}
+
 		integer& operator&=(const integer& other) {
 			container::operator&=(other);
 			negative = negative && other.negative;
@@ -203,17 +254,27 @@ namespace C163q {
 		}
 
 		// return lhs.abs() ^ rhs.abs() and lhs.is_negative() != rhs.is_negative()
-		[[nodiscard]] integer operator^(const integer& other) const {
+		[[nodiscard]] integer operator^(const integer& other) const& {
 			return integer(container::operator^(other), negative != other.negative);
 		}
 
+		[[nodiscard]] integer operator^(const integer& other)&& {
+			operator^=(other);
+			return ::std::move(*this);
+		}
+
 		integer& operator^=(const integer& other) {
 			container::operator^=(other);
 			negative = negative != other.negative;
 			return *this;
 		}
 
-		[[nodiscard]] integer operator+(const integer& other) const;
+		[[nodiscard]] integer operator+(const integer& other) const&;
+
+		[[nodiscard]] integer operator+(const integer& other)&& {
+			operator+=(other);
+			return ::std::move(*this);
+		}
 
 		integer& operator+=(const integer& other) {
 			if (negative == other.negative) {
@@ -222,7 +283,12 @@ namespace C163q {
 			return abs_sub(other);
 		}
 
-		[[nodiscard]] integer operator-(const integer& other) const;
+		[[nodiscard]] integer operator-(const integer& other) const&;
+
+		[[nodiscard]] integer operator-(const integer& other)&& {
+			operator-=(other);
+			return ::std::move(*this);
+		}
 
 		integer& operator-=(const integer& other) {
 			if (negative == other.negative) {
@@ -231,27 +297,39 @@ namespace C163q {
 			return abs_add(other);
 		}
 
-		[[nodiscard]] integer operator*(const integer& other) const;
+		[[nodiscard]] integer operator*(const integer& other) const&;
 
-		integer& operator*=(const integer& other) {
-			operator=(operator*(other));
-			return *this;
+		[[nodiscard]] integer operator*(const integer& other)&& {
+			operator*=(other);
+			return ::std::move(*this);
 		}
 
-		[[nodiscard]] integer operator/(const integer& other) const;
+		// return (*this) * (*this), 使用平方算法, 约只需一般乘法一半的limb乘积
+		[[nodiscard]] integer square() const;
 
-		integer& operator/=(const integer& other) {
-			operator=(operator/(other));
-			return *this;
+		// 乘积先写入临时缓冲区再复制回来, 复用*this已有的存储. other可以是*this
+		integer& operator*=(const integer& other);
+
+		[[nodiscard]] integer operator/(const integer& other) const&;
+
+		[[nodiscard]] integer operator/(const integer& other)&& {
+			operator/=(other);
+			return ::std::move(*this);
 		}
 
-		[[nodiscard]] integer operator%(const integer& other) const;
+		// 在*this上求商, 复用已有的存储. other可以是*this
+		integer& operator/=(const integer& other);
 
-		integer& operator%=(const integer& other) {
-			operator=(operator%(other));
-			return *this;
+		[[nodiscard]] integer operator%(const integer& other) const&;
+
+		[[nodiscard]] integer operator%(const integer& other)&& {
+			operator%=(other);
+			return ::std::move(*this);
 		}
 
+		// 在*this上求余数, 复用已有的存储. other可以是*this
+		integer& operator%=(const integer& other);
+
 		integer& operator++() {
 			if (!negative) {
 				abs_self_incre();
@@ -290,9 +368,13 @@ namespace C163q {
 			return ret;
 		}
 
-		[[nodiscard]] ::std::string ToString() const;
+		// 转换为base进制字符串, 大于9的数字使用小写字母. base为2的幂时代价为线性. Note: 2 <= base <= 36
+		[[nodiscard]] ::std::string ToString(const unsigned base = 10) const;
 
 	private:
+		// 把first[0..len)按base进制解析为绝对值, 符号不变. Note: 每个字符都是合法数字, 可复用已有的存储空间
+		void assign_digits(const char* first, const size_t len, const unsigned base);
+
 		// return lhs.abs() += rhs.abs(), return *this!!!
 		integer& abs_add(const integer& other);
 
@@ -308,6 +390,12 @@ namespace C163q {
 		// return lhs.abs() * unit_t
 		[[nodiscard]] integer abs_mult_unit(const unit_t& other) const;
 
+		// lhs.abs() *= rhs.abs(), 符号不变. Note: lhs, rhs != 0
+		void abs_mult_assign(const integer& other);
+
+		// lhs.abs() /= rhs.abs()(quotient为true)或lhs.abs() %= rhs.abs(), 符号不变. Note: rhs != 0
+		void abs_divrem_assign(const integer& other, const bool quotient);
+
 		// return lhs.abs() / rhs.abs(). Note: rhs != 0
 		[[nodiscard]] integer abs_div(const integer& other) const {
 #if _DEBUG
@@ -328,6 +416,22 @@ namespace C163q {
 			return make_div(other).second;
 		}
 
+		// *this += (product_negative ? -1 : 1) * |a[0..an) * b[0..bn)|. Note: an >= bn >= 1, a与b不能是*this的存储
+		void mul_accumulate(const unit_t* a, const size_t an, const unit_t* b, const size_t bn, const bool product_negative);
+
+		// *this += (product_negative ? -1 : 1) * |a * b|, a或b可以是*this
+		void fused_mul(const integer& a, const integer& b, const bool product_negative);
+
+		// 半GCD中累积的余因子矩阵, 见integer.cpp
+		struct hgcd_matrix;
+
+		// 半GCD(Möller): 沿Euclid余数序列把(a, b)约化到仍满足b >= 2^s且a - b >= 2^s的位置, 所做的步骤右乘到m上(m可以为nullptr).
+		// 先对截去低位的高半部分递归, 再对约化后的数的高半部分递归, 代价为O(M(n) log n). Note: a > b
+		static void hgcd(integer& a, integer& b, const size_t s, hgcd_matrix* m);
+
+		// `hgcd`的基础情形: 逐步(可能时用Lehmer矩阵一次多步)做Euclid算法, 直到下一步会破坏上述条件
+		static void hgcd_basecase(integer& a, integer& b, const size_t s, hgcd_matrix* m);
+
 		// Note: lhs.abs() >= rhs.abs(), 返回左商,右余数
 		[[nodiscard]] ::std::pair<integer, integer> make_div(const integer& other) const;
 
@@ -389,10 +493,61 @@ namespace C163q {
 
 		friend integer gcd(const integer& first, const integer& second);
 
+		friend ::std::tuple<integer, integer, integer> xgcd(const integer& first, const integer& second);
+
 		inline friend integer lcm(const integer& first, const integer& second);
 
+		friend integer pow(const integer& base, unsigned long exp);
+
+		friend integer iroot(const integer& value, unsigned long k);
+
+		friend bool is_perfect_square(const integer& value);
+
+		friend bool is_perfect_power(const integer& value);
+
+		friend void addmul(integer& acc, const integer& a, const integer& b);
+
+		friend void submul(integer& acc, const integer& a, const integer& b);
+
+		friend void addmul_unit(integer& acc, const integer& a, const integer_container::unit_t b);
+
+		friend ::std::size_t to_chars_length(const integer& value, int base) noexcept;
+
+		friend ::std::to_chars_result to_chars(char* first, char* last, const integer& value, int base);
+
+		friend ::std::from_chars_result from_chars(const char* first, const char* last, integer& value, int base);
+
 	};
 
+	// 以base进制写出value所需字符数(含符号). base为2的幂时为精确值, 否则为上界.
+	// Note: 2 <= base <= 36
+	[[nodiscard]] ::std::size_t to_chars_length(const integer& value, int base = 10) noexcept;
+
+	// 同`::std::to_chars`: 把value写入[first, last), 不写入结尾的'\0'. 空间不足时返回{ last, value_too_large },
+	// [first, last)的内容未指定. 临时空间取自线程局部的缓冲池, 稳定后不再分配内存. Note: 2 <= base <= 36
+	::std::to_chars_result to_chars(char* first, char* last, const integer& value, int base = 10);
+
+	// 同`::std::from_chars`: 可带'-'号(不接受'+'), 解析尽可能长的数字序列, ptr指向第一个未解析的字符.
+	// 没有数字时返回{ first, invalid_argument }且value不变. 会复用value已有的存储空间. Note: 2 <= base <= 36
+	::std::from_chars_result from_chars(const char* first, const char* last, integer& value, int base = 10);
+
+	// acc += a * b. 积直接累加到acc的limb上, 不构造临时integer; 乘数较小时逐行一次完成.
+	// a或b可以是acc
+	void addmul(integer& acc, const integer& a, const integer& b);
+
+	// acc -= a * b, 其余同`addmul`
+	void submul(integer& acc, const integer& a, const integer& b);
+
+	// acc += a * b, b为单个limb
+	void addmul_unit(integer& acc, const integer& a, const integer_container::unit_t b);
+
+	// 最大公因数(非负), 任一个为0时返回0. 不超过两个limb时用Stein二进制算法, 否则用Lehmer算法
+	[[nodiscard]] integer gcd(const integer& first, const integer& second);
+
+	// 扩展欧几里得算法: 返回{ g, x, y }, 满足first * x + second * y == g, g = gcd(|first|, |second|)(其中一个为0时为另一个的绝对值).
+	// 系数由Lehmer余因子矩阵直接累积得到, 不需要额外的除法; 与逐步做Euclid算法得到的系数相同
+	[[nodiscard]] ::std::tuple<integer, integer, integer> xgcd(const integer& first, const integer& second);
+
 	[[nodiscard]] inline integer lcm(const integer& first, const integer& second) {
 		integer gcd_res(gcd(first, second));
 		if (gcd_res.is_zero()) {
@@ -402,6 +557,25 @@ namespace C163q {
 		return (first / gcd_res * second).make_abs();
 	}
 
+	// base^exp, 0^0 = 1. base的因子2先提出来, 奇数部分用平方算法做从高位开始的反复平方, 最后整体左移一次;
+	// base为±2^k时只做一次移位
+	[[nodiscard]] integer pow(const integer& base, unsigned long exp);
+
+	// value的k次方根, 向0取整. Note: k >= 1, value为负数时k必须为奇数, 否则抛出`::std::domain_error`
+	[[nodiscard]] integer iroot(const integer& value, unsigned long k);
+
+	// value的平方根, 向下取整. Note: value >= 0
+	[[nodiscard]] inline integer isqrt(const integer& value) {
+		return iroot(value, 2);
+	}
+
+	// value是否为完全平方数(0与1也是). 先用模64, 63, 65, 11的平方剩余表排除, 通过后才开方验证
+	[[nodiscard]] bool is_perfect_square(const integer& value);
+
+	// 是否存在整数a与k >= 2使value == a^k(0, 1, -1也算). 只需检验素数次数p: 去掉因子2后,
+	// 根较大时先用模q(q ≡ 1 (mod p)的小素数)的p次剩余排除, 根较小时由对数估计出候选根, 比较最低的limb后再整体验证
+	[[nodiscard]] bool is_perfect_power(const integer& value);
+
 
 }
 
@@ -1,7 +1,35 @@
 ﻿#include"integer_container.h"
+#include"integer_kernel.h"
+#include<assert.h>
+#include<cstring>
 
 namespace C163q {
 
+	namespace {
+		using unit_t = integer_container::unit_t;
+		constexpr unsigned unit_bit = integer_container::unit_bit;
+
+		// 低len位为1的掩码. Note: len <= unit_bit
+		[[nodiscard]] unit_t low_mask(const unsigned len) noexcept {
+			return len >= unit_bit ? integer_container::unit_max : (static_cast<unit_t>(1U) << len) - 1;
+		}
+
+		// 从p开始的第bit位起取len位, 可以跨越两个limb. Note: 0 < len <= unit_bit, 只读取区间覆盖的limb
+		[[nodiscard]] unit_t load_bits(const unit_t* p, const size_t bit, const unsigned len) noexcept {
+			p += bit / unit_bit;
+			const unsigned offset = static_cast<unsigned>(bit % unit_bit);
+			unit_t value = p[0] >> offset;
+			if (offset + len > unit_bit) value |= p[1] << (unit_bit - offset);
+			return value & low_mask(len);
+		}
+
+		// 把value的低len位写到第offset位开始的位置, 不跨越limb. Note: offset + len <= unit_bit
+		void store_bits(unit_t& unit, const unsigned offset, const unsigned len, const unit_t value) noexcept {
+			const unit_t mask = low_mask(len) << offset;
+			unit = (unit & ~mask) | ((value << offset) & mask);
+		}
+	}
+
 
 	[[nodiscard]] bool integer_container::operator==(const integer_container& other) const noexcept {
 		if (this == ::std::addressof(other)) return true;
@@ -40,89 +68,215 @@ namespace C163q {
 
 	integer_container& integer_container::operator>>=(const size_t& bit) noexcept {
 		const unsigned bit_shift = static_cast<unsigned>(bit % unit_bit);
-		const size_t drop_byte = ::std::min(bit / unit_bit, size());
-		erase(begin(), begin() + drop_byte);
-		if (!bit_shift) return *this;	// necessary
-		unit_t last_bit{};
-		unit_t now_bit{};
-		for (reverse_iterator it = rbegin(); it != rend(); ++it) {
-			now_bit = unit_max >> (unit_bit - bit_shift);
-			now_bit &= *it;
-			*it >>= bit_shift;
-			last_bit <<= (unit_bit - bit_shift);
-			*it |= last_bit;
-			last_bit = now_bit;
+		const size_t drop_byte = bit / unit_bit;
+		if (drop_byte >= size()) {
+			clear();
+			return *this;
 		}
+		// 整limb的部分与剩余的位移一次完成, 结果直接写到低位
+		const size_t remain = size() - drop_byte;
+		if (bit_shift) {
+			kernel::rshift(data(), data() + drop_byte, remain, bit_shift);
+		}
+		else if (drop_byte) {
+			::std::memmove(data(), data() + drop_byte, remain * sizeof(unit_t));
+		}
+		resize(remain);
 		normalize();
 		return *this;
 	}
 
 	integer_container& integer_container::operator<<=(const size_t& bit) {
+		if (is_zero()) return *this;
 		const unsigned bit_shift = static_cast<unsigned>(bit % unit_bit);
 		const size_t insert_byte = bit / unit_bit;
-		unit_t last_bit{};
-		unit_t now_bit{};
-		if (bit_shift) {	// necessary
-			for (iterator it = begin(); it != end(); ++it) {
-				now_bit = unit_max << (unit_bit - bit_shift);
-				now_bit &= *it;
-				*it <<= bit_shift;
-				last_bit >>= (unit_bit - bit_shift);
-				*it |= last_bit;
-				last_bit = now_bit;
-			}
-			push_back(last_bit >> (unit_bit - bit_shift));
+		const size_t old_size = size();
+		// 先一次性扩展到结果的大小, 再从高位向低位移动, 不在头部插入
+		resize(old_size + insert_byte + (bit_shift ? 1 : 0));
+		if (bit_shift) {
+			operator[](old_size + insert_byte) = kernel::lshift(data() + insert_byte, data(), old_size, bit_shift);
+		}
+		else if (insert_byte) {
+			::std::memmove(data() + insert_byte, data(), old_size * sizeof(unit_t));
 		}
-		insert(begin(), insert_byte, 0);
+		::std::fill(begin(), begin() + insert_byte, unit_t{});
 		normalize();
 		return *this;
 	}
 
-	[[nodiscard]] integer_container integer_container::operator|(const integer_container& other) const {
-		integer_container res;
-		res.reserve(::std::max(size(), other.size()));
-		size_t i = 0;
-		for (; i < ::std::min(size(), other.size()); ++i) {
-			res.push_back(operator[](i) | other[i]);
-		}
-		while (i < size()) {
-			res.push_back(operator[](i));
-			++i;
+	[[nodiscard]] integer_container integer_container::operator<<(const size_t& bit) const {
+		if (is_zero()) return {};
+		const unsigned bit_shift = static_cast<unsigned>(bit % unit_bit);
+		const size_t insert_byte = bit / unit_bit;
+		integer_container ret{ container_base_t(size() + insert_byte + 1) };
+		if (bit_shift) {
+			ret[size() + insert_byte] = kernel::lshift(ret.data() + insert_byte, data(), size(), bit_shift);
 		}
-		while (i < other.size()) {
-			res.push_back(other[i]);
-			++i;
+		else {
+			::std::copy(begin(), end(), ret.begin() + insert_byte);
 		}
+		ret.normalize();
+		return ret;
+	}
+
+	[[nodiscard]] integer_container integer_container::operator|(const integer_container& other) const {
+		const bool longer = size() >= other.size();
+		integer_container res(longer ? *this : other);
+		const integer_container& shorter = longer ? other : *this;
+		kernel::ior_n(res.data(), res.data(), shorter.data(), shorter.size());
 		return res;
 	}
 
 	[[nodiscard]] integer_container integer_container::operator&(const integer_container& other) const {
-		integer_container res;
-		size_t min_size{ ::std::min(size(), other.size()) };
-		res.reserve(min_size);
-		for (size_t i{ 0 }; i < min_size; ++i) {
-			res.push_back(operator[](i) & other[i]);
-		}
+		const size_t min_size{ ::std::min(size(), other.size()) };
+		integer_container res{ container_base_t(min_size) };
+		kernel::and_n(res.data(), data(), other.data(), min_size);
 		res.normalize();
 		return res;
 	}
 	
 	[[nodiscard]] integer_container integer_container::operator^(const integer_container& other) const {
-		integer_container res;
-		res.reserve(::std::max(size(), other.size()));
-		size_t i{ 0 };
-		for (; i < ::std::min(size(), other.size()); ++i) {
-			res.push_back(operator[](i) ^ other[i]);
+		const bool longer = size() >= other.size();
+		integer_container res(longer ? *this : other);
+		const integer_container& shorter = longer ? other : *this;
+		kernel::xor_n(res.data(), res.data(), shorter.data(), shorter.size());
+		res.normalize();
+		return res;
+	}
+
+	integer_container& integer_container::operator|=(const integer_container& other) {
+		const size_t min_size{ ::std::min(size(), other.size()) };
+		if (size() < other.size()) {
+			insert(end(), other.begin() + min_size, other.end());
 		}
-		while (i < size()) {
-			res.push_back(operator[](i));
-			++i;
+		kernel::ior_n(data(), data(), other.data(), min_size);
+		return *this;
+	}
+
+	integer_container& integer_container::operator&=(const integer_container& other) {
+		const size_t min_size{ ::std::min(size(), other.size()) };
+		resize(min_size);
+		kernel::and_n(data(), data(), other.data(), min_size);
+		normalize();
+		return *this;
+	}
+
+	integer_container& integer_container::operator^=(const integer_container& other) {
+		const size_t min_size{ ::std::min(size(), other.size()) };
+		if (size() < other.size()) {
+			insert(end(), other.begin() + min_size, other.end());
 		}
-		while (i < other.size()) {
-			res.push_back(other[i]);
-			++i;
+		kernel::xor_n(data(), data(), other.data(), min_size);
+		normalize();	// 最高位可能被消去
+		return *this;
+	}
+
+	[[nodiscard]] size_t integer_container::popcount() const noexcept {
+		size_t count{};
+		for (const unit_t unit : *this) {
+			count += static_cast<size_t>(::std::popcount(unit));
 		}
-		return res;
+		return count;
+	}
+
+	[[nodiscard]] size_t integer_container::count_trailing_zeros() const noexcept {
+		for (size_t i{ 0 }; i < size(); ++i) {
+			if (operator[](i)) return i * unit_bit + static_cast<size_t>(::std::countr_zero(operator[](i)));
+		}
+		return 0;
+	}
+
+	[[nodiscard]] size_t integer_container::find_next_set_bit(const size_t pos) const noexcept {
+		size_t index = pos / unit_bit;
+		if (index >= size()) return npos;
+		// 第一个limb中屏蔽掉pos以下的位, 之后逐limb查找
+		unit_t unit = operator[](index) & (unit_max << (pos % unit_bit));
+		while (!unit) {
+			if (++index == size()) return npos;
+			unit = operator[](index);
+		}
+		return index * unit_bit + static_cast<size_t>(::std::countr_zero(unit));
+	}
+
+	[[nodiscard]] integer_container::unit_t integer_container::extract_bits(const size_t pos, const unsigned len) const noexcept {
+#if _DEBUG
+		assert(len <= unit_bit);
+#endif
+		const size_t index = pos / unit_bit;
+		if (!len || index >= size()) return 0;
+		const unsigned offset = static_cast<unsigned>(pos % unit_bit);
+		unit_t value = operator[](index) >> offset;
+		if (offset && offset + len > unit_bit && index + 1 < size()) value |= operator[](index + 1) << (unit_bit - offset);
+		return value & low_mask(len);
+	}
+
+	void integer_container::deposit_bits(const size_t pos, const unsigned len, const unit_t value) {
+#if _DEBUG
+		assert(len <= unit_bit);
+#endif
+		if (!len) return;
+		const size_t index = pos / unit_bit;
+		const unsigned offset = static_cast<unsigned>(pos % unit_bit);
+		const size_t units = index + (offset + len > unit_bit ? 2 : 1);
+		if (size() < units) resize(units);
+		const unsigned low_len = ::std::min(len, unit_bit - offset);
+		store_bits(operator[](index), offset, low_len, value);
+		if (low_len < len) store_bits(operator[](index + 1), 0, len - low_len, value >> low_len);
+		normalize();
+	}
+
+	integer_container::bit_iterator copy_bits(integer_container::const_bit_iterator first, integer_container::const_bit_iterator last,
+		integer_container::bit_iterator d_first) noexcept {
+		const unit_t* const src = first.get_base_it();
+		size_t src_bit = static_cast<size_t>(first.get_pos());
+		unit_t* dst = d_first.get_base_it();
+		unsigned dst_bit = static_cast<unsigned>(d_first.get_pos());
+		size_t remain = static_cast<size_t>(last - first);
+		d_first += remain;
+		// 每次写满目标的一个limb(或剩余部分), 读取可以跨越两个源limb
+		while (remain) {
+			const unsigned len = static_cast<unsigned>(::std::min<size_t>(remain, unit_bit - dst_bit));
+			store_bits(*dst, dst_bit, len, load_bits(src, src_bit, len));
+			src_bit += len;
+			remain -= len;
+			if ((dst_bit += len) == unit_bit) {
+				dst_bit = 0;
+				++dst;
+			}
+		}
+		return d_first;
+	}
+
+	void fill_bits(integer_container::bit_iterator first, integer_container::bit_iterator last, const bool value) noexcept {
+		unit_t* it = first.get_base_it();
+		unit_t* const end = last.get_base_it();
+		const unsigned first_pos = static_cast<unsigned>(first.get_pos());
+		const unsigned last_pos = static_cast<unsigned>(last.get_pos());
+		const unit_t fill = value ? integer_container::unit_max : 0;
+		if (it == end) {
+			if (first_pos < last_pos) store_bits(*it, first_pos, last_pos - first_pos, fill);
+			return;
+		}
+		store_bits(*it, first_pos, unit_bit - first_pos, fill);
+		::std::fill(it + 1, end, fill);
+		if (last_pos) store_bits(*end, 0, last_pos, fill);
+	}
+
+	[[nodiscard]] size_t count_ones(integer_container::const_bit_iterator first, integer_container::const_bit_iterator last) noexcept {
+		const unit_t* it = first.get_base_it();
+		const unit_t* const end = last.get_base_it();
+		const unsigned first_pos = static_cast<unsigned>(first.get_pos());
+		const unsigned last_pos = static_cast<unsigned>(last.get_pos());
+		if (it == end) {
+			if (first_pos >= last_pos) return 0;
+			return static_cast<size_t>(::std::popcount((*it >> first_pos) & low_mask(last_pos - first_pos)));
+		}
+		size_t count = static_cast<size_t>(::std::popcount(*it >> first_pos));
+		while (++it != end) {
+			count += static_cast<size_t>(::std::popcount(*it));
+		}
+		if (last_pos) count += static_cast<size_t>(::std::popcount(*end & low_mask(last_pos)));
+		return count;
 	}
 
 	using const_bit_iterator = integer_container::const_bit_iterator;
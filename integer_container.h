@@ -1,30 +1,50 @@
 ﻿#pragma once
 #include<vector>
+#include<bit>
+#include"integer_storage.h"
 #include<iostream>
 #include<utility>
 #include<exception>
 #include<type_traits>
 #include<numeric>
 #include<cstddef>
+#include<cstdint>
 #include<climits>
 #include<iterator>
 #include<limits>
 
 
+// 定义`C163Q_INTEGER_UNIT_64`时以64位为一个单元, 否则为32位.
+// 两种宽度下的运算结果相同, 64位单元在64位平台上可使循环与进位次数减半.
+// 64位单元需要`unsigned __int128`: 支持64位目标上的GCC与Clang(含clang-cl); MSVC(cl)没有128位整数, 会在这里报错.
+#if defined(C163Q_INTEGER_UNIT_64) && !defined(__SIZEOF_INT128__)
+#error "C163Q_INTEGER_UNIT_64 requires unsigned __int128"
+#endif
+
 namespace C163q {
+#if defined(C163Q_INTEGER_UNIT_64)
+	using integer_signed_unit = ::std::int64_t;
+	using integer_double_unit = unsigned __int128;
+#else
+	using integer_signed_unit = __int32;
+	using integer_double_unit = ::std::make_unsigned_t<__int64>;
+#endif
+
 	/// @brief 该类用于存储无符号整数的二进制数据,低位(32位为一个单元方便简化运算)存储在低(vector)索引中
 	/// @note 例如,对于二进制数字1111'0000'1111'0000'1111'0000'1111'0000'1010'1010'1010'1010'1010'1010'1010'1010
 	/// 将会存储为 {0b1111'0000'1111'0000'1111'0000'1111'0000, 0b1010'1010'1010'1010'1010'1010'1010'1010}
-	class integer_container : public ::std::vector<::std::make_unsigned_t<__int32>> {
+	/// 不超过`inline_units`个单元的数直接存放在对象内部, 不分配堆内存
+	class integer_container : public small_vector<::std::make_unsigned_t<integer_signed_unit>, 4> {
 	public:
 		class const_bit_iterator;
 		class bit_iterator;
 
 	public:
-		using signed_unit = __int32;							// signed 32 bit
-		using unit_t = ::std::make_unsigned_t<signed_unit>;		// unsigned 32 bit, 数据存储的最小单元
-		using double_unit_t = ::std::make_unsigned_t<__int64>;	// unsigned 64 bit
-		using container_base_t = ::std::vector<unit_t>;
+		using signed_unit = integer_signed_unit;				// signed 32 bit(或64 bit)
+		using unit_t = ::std::make_unsigned_t<signed_unit>;		// unsigned 32 bit(或64 bit), 数据存储的最小单元
+		using double_unit_t = integer_double_unit;				// unsigned 64 bit(或128 bit)
+		constexpr static ::std::size_t inline_units = 4;			// 内联存储的单元数
+		using container_base_t = small_vector<unit_t, inline_units>;
 
 	public:
 		using const_bit_iterator = const_bit_iterator;
@@ -35,7 +55,8 @@ namespace C163q {
 	public:
 		constexpr static unit_t unit_max = ::std::numeric_limits<unit_t>::max();	// unit_t最大值
 		constexpr static double_unit_t unit_division = static_cast<double_unit_t>(unit_max) + 1;
-		constexpr static unsigned unit_bit = sizeof(unit_t) * CHAR_BIT;				// 32
+		constexpr static unsigned unit_bit = sizeof(unit_t) * CHAR_BIT;				// 32或64
+		constexpr static size_t npos = static_cast<size_t>(-1);						// `find_next_set_bit`找不到时的返回值
 
 	public:
 		// 清除高位的0, 这些0没有意义
@@ -458,7 +479,8 @@ namespace C163q {
 			return *this;
 		}
 
-		integer_container& operator=(integer_container&& other) noexcept {
+		// 内存资源不同时会复制元素(见`small_vector`), 因此可能分配内存
+		integer_container& operator=(integer_container&& other) {
 			if (this == ::std::addressof(other)) return *this;
 			container_base_t::operator=(::std::move(other));
 			return *this;
@@ -477,6 +499,27 @@ namespace C163q {
 			return (size() == 1 && operator[](0) == 1);
 		}
 
+		// 二进制位数, 即最高位的1的位置加1. 0的位数为0
+		[[nodiscard]] size_t bit_length() const noexcept {
+			if (is_zero()) return 0;
+			return size() * unit_bit - static_cast<size_t>(::std::countl_zero(back()));
+		}
+
+		// 1的个数
+		[[nodiscard]] size_t popcount() const noexcept;
+
+		// 最低位起连续0的个数, 即最低位的1的位置. 0返回0
+		[[nodiscard]] size_t count_trailing_zeros() const noexcept;
+
+		// 第pos位及更高位中最低的1的位置, 不存在时返回`npos`
+		[[nodiscard]] size_t find_next_set_bit(const size_t pos) const noexcept;
+
+		// 取出从第pos位开始的len位, 放在返回值的低位. 超出最高limb的位视为0. Note: len <= unit_bit
+		[[nodiscard]] unit_t extract_bits(const size_t pos, const unsigned len) const noexcept;
+
+		// 把value的低len位写到第pos位开始的位置, 需要时扩展长度. Note: len <= unit_bit
+		void deposit_bits(const size_t pos, const unsigned len, const unit_t value);
+
 		[[nodiscard]] bool operator==(const integer_container& other) const noexcept;
 		
 		[[nodiscard]] bool operator>(const integer_container& other) const noexcept;
@@ -509,35 +552,20 @@ namespace C163q {
 
 		integer_container& operator<<=(const size_t& bit);
 
-		[[nodiscard]] integer_container operator<<(const size_t& bit) const {
-			const size_t insert_byte = bit / unit_bit;
-			integer_container ret;
-			ret.reserve(insert_byte + size() + 1);
-			ret.insert(ret.end(), insert_byte, 0);
-			ret.insert(ret.end(), begin(), end());
-			return ret.operator<<=(bit % unit_bit);
-		}
+		[[nodiscard]] integer_container operator<<(const size_t& bit) const;
 
 		[[nodiscard]] integer_container operator|(const integer_container& other) const;
 
-		integer_container& operator|=(const integer_container& other) {
-			operator=(::std::move(operator|(other)));
-			return *this;
-		}
+		// 直接在*this上运算, 不构造临时对象. other可以是*this
+		integer_container& operator|=(const integer_container& other);
 
 		[[nodiscard]] integer_container operator&(const integer_container& other) const;
 
-		integer_container& operator&=(const integer_container& other) {
-			operator=(::std::move(operator&(other)));
-			return *this;
-		}
+		integer_container& operator&=(const integer_container& other);
 
 		[[nodiscard]] integer_container operator^(const integer_container& other) const;
 
-		integer_container& operator^=(const integer_container& other) {
-			operator=(::std::move(operator^(other)));
-			return *this;
-		}
+		integer_container& operator^=(const integer_container& other);
 
 		// 返回指向最低位的`bit_iterator`. eg. 0b1001100...00101`1`
 		[[nodiscard]] bit_iterator bit_begin() noexcept {
@@ -554,35 +582,13 @@ namespace C163q {
 
 		// 返回指向非0最高位后一位的`bit_iterator`. eg. 0b`0`100100..001011
 		[[nodiscard]] bit_iterator bit_end() noexcept {
-			if (is_zero()) { return bit_iterator(end(), 0); }
-			container_base_t::iterator byte_it = ::std::prev(end());
-			bit_iterator::bit_pos_t bit_it{};
-			unit_t tmp = *byte_it;
-			while (tmp) {
-				tmp >>= 1;
-				++bit_it;
-			}
-			if (bit_it >= unit_bit) {
-				++byte_it;
-				bit_it -= unit_bit;
-			}
-			return bit_iterator(byte_it, bit_it);
+			const size_t length = bit_length();
+			return bit_iterator(begin() + length / unit_bit, static_cast<bit_iterator::bit_pos_t>(length % unit_bit));
 		}
 
 		[[nodiscard]] const_bit_iterator bit_cend() const noexcept {
-			if (is_zero()) { return const_bit_iterator(cend(), 0); }
-			container_base_t::const_iterator byte_it = ::std::prev(cend());
-			bit_iterator::bit_pos_t bit_it{};
-			unit_t tmp = *byte_it;
-			while (tmp) {
-				tmp >>= 1;
-				++bit_it;
-			}
-			if (bit_it >= unit_bit) {
-				++byte_it;
-				bit_it -= unit_bit;
-			}
-			return const_bit_iterator(byte_it, bit_it);
+			const size_t length = bit_length();
+			return const_bit_iterator(cbegin() + length / unit_bit, static_cast<const_bit_iterator::bit_pos_t>(length % unit_bit));
 		}
 
 		[[nodiscard]] const_bit_iterator bit_end() const noexcept {
@@ -617,5 +623,17 @@ namespace C163q {
 
 	};
 
-}
+	// 以下区间操作都按limb整块处理(区间两端不完整的limb用掩码), 代价与区间覆盖的limb数成正比
+
+	// 把[first, last)的位复制到d_first开始的位置, 返回目标区间的末尾.
+	// Note: 与`::std::copy`相同, 区间可以重叠, 但d_first不能位于(first, last)内
+	integer_container::bit_iterator copy_bits(integer_container::const_bit_iterator first, integer_container::const_bit_iterator last,
+		integer_container::bit_iterator d_first) noexcept;
+
+	// 把[first, last)的位全部置为value
+	void fill_bits(integer_container::bit_iterator first, integer_container::bit_iterator last, const bool value) noexcept;
 
+	// [first, last)中1的个数
+	[[nodiscard]] size_t count_ones(integer_container::const_bit_iterator first, integer_container::const_bit_iterator last) noexcept;
+
+}
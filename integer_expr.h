@@ -0,0 +1,230 @@
+﻿#pragma once
+#include<cstddef>
+#include<memory>
+#include<type_traits>
+#include<utility>
+#include"integer.h"
+
+
+/// @brief `integer`的表达式模板(可选). 用`lazy(x)`包装操作数后, + - * / %只记录表达式, 赋值时才求值:
+/// a * b + c * d这类乘加通过`addmul`/`submul`直接累加到目标的存储中, 除乘数外不构造中间的`integer`.
+/// eg. `expr::assign(acc, expr::lazy(acc) + expr::lazy(a) * b - expr::lazy(c) * d);`
+/// @note 只要有一侧是表达式运算就会延迟; 两侧都是`integer`时仍由`integer`的运算符立即求值, 所以每个乘积至少要有一侧用`lazy`包装.
+/// 叶子节点只保存引用, 保存下来的表达式不能比其中的操作数活得更久.
+namespace C163q::expr {
+
+	template<class Derived>
+	class expression;
+
+	template<class E>
+	integer& assign(integer& dst, const expression<E>& e);
+
+	template<class Derived>
+	class expression {
+	public:
+		[[nodiscard]] const Derived& self() const noexcept {
+			return static_cast<const Derived&>(*this);
+		}
+
+		[[nodiscard]] operator integer() const {
+			integer ret;
+			assign(ret, *this);
+			return ret;
+		}
+	};
+
+	/// @brief 叶子节点, 引用一个已有的`integer`
+	class integer_ref : public expression<integer_ref> {
+	private:
+		const integer& value;
+
+	public:
+		explicit integer_ref(const integer& value) noexcept : value(value) {}
+
+		[[nodiscard]] const integer& get() const noexcept {
+			return value;
+		}
+
+		[[nodiscard]] ::std::size_t references(const integer& x) const noexcept {
+			return ::std::addressof(value) == ::std::addressof(x);
+		}
+
+		[[nodiscard]] const integer& leftmost() const noexcept {
+			return value;
+		}
+	};
+
+	namespace op {
+		struct plus {};
+		struct minus {};
+		struct multiplies {};
+		struct divides {};
+		struct modulus {};
+	}
+
+	template<class Op, class L, class R>
+	class binary : public expression<binary<Op, L, R>> {
+	public:
+		L lhs;
+		R rhs;
+
+		binary(const L& lhs, const R& rhs) : lhs(lhs), rhs(rhs) {}
+
+		// 表达式中引用x的叶子个数
+		[[nodiscard]] ::std::size_t references(const integer& x) const noexcept {
+			return lhs.references(x) + rhs.references(x);
+		}
+
+		// 求值时最先读取的叶子
+		[[nodiscard]] const integer& leftmost() const noexcept {
+			return lhs.leftmost();
+		}
+	};
+
+	[[nodiscard]] inline integer_ref lazy(const integer& x) noexcept {
+		return integer_ref(x);
+	}
+
+	template<class T>
+	inline constexpr bool is_expression_v = ::std::is_base_of_v<expression<T>, T>;
+
+	// `integer`作为操作数时包装为`integer_ref`
+	template<class T>
+	using operand_t = ::std::conditional_t<::std::is_same_v<T, integer>, integer_ref, T>;
+
+	template<class L, class R>
+	inline constexpr bool enable_operator_v = (is_expression_v<L> || is_expression_v<R>)
+		&& (is_expression_v<L> || ::std::is_same_v<L, integer>)
+		&& (is_expression_v<R> || ::std::is_same_v<R, integer>);
+
+	template<class L, class R, class = ::std::enable_if_t<enable_operator_v<L, R>>>
+	[[nodiscard]] binary<op::plus, operand_t<L>, operand_t<R>> operator+(const L& lhs, const R& rhs) {
+		return { operand_t<L>(lhs), operand_t<R>(rhs) };
+	}
+
+	template<class L, class R, class = ::std::enable_if_t<enable_operator_v<L, R>>>
+	[[nodiscard]] binary<op::minus, operand_t<L>, operand_t<R>> operator-(const L& lhs, const R& rhs) {
+		return { operand_t<L>(lhs), operand_t<R>(rhs) };
+	}
+
+	template<class L, class R, class = ::std::enable_if_t<enable_operator_v<L, R>>>
+	[[nodiscard]] binary<op::multiplies, operand_t<L>, operand_t<R>> operator*(const L& lhs, const R& rhs) {
+		return { operand_t<L>(lhs), operand_t<R>(rhs) };
+	}
+
+	template<class L, class R, class = ::std::enable_if_t<enable_operator_v<L, R>>>
+	[[nodiscard]] binary<op::divides, operand_t<L>, operand_t<R>> operator/(const L& lhs, const R& rhs) {
+		return { operand_t<L>(lhs), operand_t<R>(rhs) };
+	}
+
+	template<class L, class R, class = ::std::enable_if_t<enable_operator_v<L, R>>>
+	[[nodiscard]] binary<op::modulus, operand_t<L>, operand_t<R>> operator%(const L& lhs, const R& rhs) {
+		return { operand_t<L>(lhs), operand_t<R>(rhs) };
+	}
+
+	namespace detail {
+		template<class E>
+		void evaluate(integer& dst, const E& e);
+
+		// 叶子直接返回引用, 其余节点求值到临时对象
+		[[nodiscard]] inline const integer& materialize(const integer_ref& e) noexcept {
+			return e.get();
+		}
+
+		template<class E>
+		[[nodiscard]] integer materialize(const E& e) {
+			integer ret;
+			evaluate(ret, e);
+			return ret;
+		}
+
+		// dst += e(positive为true)或dst -= e. 加减节点展开, 乘法节点用`addmul`/`submul`直接累加
+		template<class E>
+		void accumulate(integer& dst, const E& e, const bool positive) {
+			if (positive) dst += materialize(e);
+			else dst -= materialize(e);
+		}
+
+		template<class L, class R>
+		void accumulate(integer& dst, const binary<op::plus, L, R>& e, const bool positive) {
+			accumulate(dst, e.lhs, positive);
+			accumulate(dst, e.rhs, positive);
+		}
+
+		template<class L, class R>
+		void accumulate(integer& dst, const binary<op::minus, L, R>& e, const bool positive) {
+			accumulate(dst, e.lhs, positive);
+			accumulate(dst, e.rhs, !positive);
+		}
+
+		template<class L, class R>
+		void accumulate(integer& dst, const binary<op::multiplies, L, R>& e, const bool positive) {
+			if (positive) addmul(dst, materialize(e.lhs), materialize(e.rhs));
+			else submul(dst, materialize(e.lhs), materialize(e.rhs));
+		}
+
+		inline void evaluate_node(integer& dst, const integer_ref& e) {
+			dst = e.get();
+		}
+
+		template<class L, class R>
+		void evaluate_node(integer& dst, const binary<op::plus, L, R>& e) {
+			evaluate(dst, e.lhs);
+			accumulate(dst, e.rhs, true);
+		}
+
+		template<class L, class R>
+		void evaluate_node(integer& dst, const binary<op::minus, L, R>& e) {
+			evaluate(dst, e.lhs);
+			accumulate(dst, e.rhs, false);
+		}
+
+		template<class L, class R>
+		void evaluate_node(integer& dst, const binary<op::multiplies, L, R>& e) {
+			if constexpr (::std::is_same_v<L, integer_ref>) {
+				if (::std::addressof(e.lhs.get()) != ::std::addressof(dst)) {
+					dst.set_zero();
+					addmul(dst, e.lhs.get(), materialize(e.rhs));
+					return;
+				}
+			}
+			evaluate(dst, e.lhs);
+			dst *= materialize(e.rhs);
+		}
+
+		template<class L, class R>
+		void evaluate_node(integer& dst, const binary<op::divides, L, R>& e) {
+			evaluate(dst, e.lhs);
+			dst /= materialize(e.rhs);
+		}
+
+		template<class L, class R>
+		void evaluate_node(integer& dst, const binary<op::modulus, L, R>& e) {
+			evaluate(dst, e.lhs);
+			dst %= materialize(e.rhs);
+		}
+
+		// 总是先求出最左边的叶子并写入dst, 再在dst上原地运算
+		template<class E>
+		void evaluate(integer& dst, const E& e) {
+			evaluate_node(dst, e);
+		}
+	}
+
+	/// @brief 把e求值到dst中, 复用dst已有的存储. dst只作为最左边的操作数出现时(eg. `lazy(dst) + lazy(a) * b`)直接原地运算,
+	/// 否则先求值到临时对象再移动到dst.
+	template<class E>
+	integer& assign(integer& dst, const expression<E>& e) {
+		const E& node = e.self();
+		const ::std::size_t refs = node.references(dst);
+		if (refs == 0 || (refs == 1 && ::std::addressof(node.leftmost()) == ::std::addressof(dst))) {
+			detail::evaluate(dst, node);
+			return dst;
+		}
+		integer tmp;
+		detail::evaluate(tmp, node);
+		dst = ::std::move(tmp);
+		return dst;
+	}
+
+}
@@ -0,0 +1,175 @@
+﻿#include"integer_kernel.h"
+#include<algorithm>
+#include<bit>
+#include<utility>
+
+// 最大公因数. 两数都不超过两个limb时用Stein二进制算法; 否则用Lehmer算法: 只取最高的两个limb模拟Euclid算法的若干步,
+// 把这些步的商累积成2x2余因子矩阵后一次作用到整个数上, 商无法由最高位确定时退回一次完整的除法.
+
+namespace C163q::kernel {
+
+	namespace {
+		// 模拟时取的最高位数, 留出一位使其与余因子相加时不会溢出
+		constexpr unsigned lehmer_bits = 2 * unit_bit - 1;
+
+		[[nodiscard]] unsigned countr_zero_double(const double_unit_t x) noexcept {
+			const unit_t low = static_cast<unit_t>(x);
+			if (low) return static_cast<unsigned>(::std::countr_zero(low));
+			return unit_bit + static_cast<unsigned>(::std::countr_zero(static_cast<unit_t>(x >> unit_bit)));
+		}
+
+		// Note: n >= 1, a[n-1] != 0
+		[[nodiscard]] ::std::size_t bit_length(const unit_t* a, const ::std::size_t n) noexcept {
+			return n * unit_bit - static_cast<::std::size_t>(::std::countl_zero(a[n - 1]));
+		}
+
+		// a[0..n)从第pos位开始的2 * unit_bit位, n以外的limb视为0
+		[[nodiscard]] double_unit_t bits_at(const unit_t* a, const ::std::size_t n, const ::std::size_t pos) noexcept {
+			const auto limb = [a, n](const ::std::size_t i) -> double_unit_t { return i < n ? a[i] : 0; };
+			const ::std::size_t i = pos / unit_bit;
+			const unsigned offset = static_cast<unsigned>(pos % unit_bit);
+			double_unit_t ret = (limb(i) | limb(i + 1) << unit_bit) >> offset;
+			if (offset) ret |= limb(i + 2) << (2 * unit_bit - offset);
+			return ret;
+		}
+
+		// r[0..n] = x[0..n) * u - y[0..n) * v, 返回去掉前导0后的长度. Note: 结果非负
+		::std::size_t combine(unit_t* r, const unit_t* x, const unit_t u, const unit_t* y, const unit_t v, ::std::size_t n) noexcept {
+			r[n] = mul_1(r, x, n, u);
+			r[n] -= submul_1(r, y, n, v);
+			++n;
+			while (n && !r[n - 1]) --n;
+			return n;
+		}
+
+		::std::size_t normalized_size(const unit_t* a, ::std::size_t n) noexcept {
+			while (n && !a[n - 1]) --n;
+			return n;
+		}
+	}
+
+	[[nodiscard]] double_unit_t gcd_2(double_unit_t a, double_unit_t b) noexcept {
+		if (!a) return b;
+		if (!b) return a;
+		const unsigned shift = ::std::min(countr_zero_double(a), countr_zero_double(b));
+		a >>= countr_zero_double(a);
+		do {
+			b >>= countr_zero_double(b);
+			if (a > b) ::std::swap(a, b);
+			b -= a;
+		} while (b);
+		return a << shift;
+	}
+
+	bool lehmer_step(lehmer_matrix& m, const unit_t* a, const ::std::size_t an, const unit_t* b, const ::std::size_t bn) noexcept {
+		const ::std::size_t len = bit_length(a, an);
+		const ::std::size_t pos = len > lehmer_bits ? len - lehmer_bits : 0;
+		double_unit_t x = bits_at(a, an, pos);
+		double_unit_t y = bits_at(b, bn, pos);
+		// 真实的商夹在(x + A) / (y + C)与(x + B) / (y + D)之间(Knuth算法L), A..D为带符号的余因子.
+		// 余因子的符号按步数的奇偶交替, 这里只记录绝对值
+		unit_t m00{ 1 }, m01{}, m10{}, m11{ 1 };
+		bool odd{};
+		for (;;) {
+			double_unit_t n1, d1, n2, d2;
+			if (!odd) {
+				if (y < m10 || x < m01) break;
+				n1 = x + m00;
+				d1 = y - m10;
+				n2 = x - m01;
+				d2 = y + m11;
+			}
+			else {
+				if (x < m00 || y < m11) break;
+				n1 = x - m00;
+				d1 = y + m10;
+				n2 = x + m01;
+				d2 = y - m11;
+			}
+			if (!d1 || !d2) break;
+			const double_unit_t q = n1 / d1;
+			if (q != n2 / d2 || q > integer_container::unit_max || q * y > x) break;
+			const double_unit_t c = m00 + q * m10;
+			const double_unit_t d = m01 + q * m11;
+			if (c > integer_container::unit_max || d > integer_container::unit_max) break;
+			m00 = m10;
+			m01 = m11;
+			m10 = static_cast<unit_t>(c);
+			m11 = static_cast<unit_t>(d);
+			odd = !odd;
+			const double_unit_t t = x - q * y;
+			x = y;
+			y = t;
+		}
+		if (!m01) return false;
+		m = { m00, m01, m10, m11, odd };
+		return true;
+	}
+
+	void lehmer_apply(unit_t* ra, ::std::size_t& ran, unit_t* rb, ::std::size_t& rbn,
+		const lehmer_matrix& m, const unit_t* a, const unit_t* b, const ::std::size_t n) noexcept {
+		if (!m.odd) {
+			ran = combine(ra, a, m.m00, b, m.m01, n);
+			rbn = combine(rb, b, m.m11, a, m.m10, n);
+		}
+		else {
+			ran = combine(ra, b, m.m01, a, m.m00, n);
+			rbn = combine(rb, a, m.m10, b, m.m11, n);
+		}
+	}
+
+	::std::size_t gcd(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) {
+		const ::std::size_t n = ::std::max(an, bn) + 1;
+		const scratch_buffer<unit_t> buffer(4 * n);
+		unit_t* x = buffer.data();
+		unit_t* y = x + n;
+		unit_t* tx = y + n;
+		unit_t* ty = tx + n;
+		::std::copy(a, a + an, x);
+		::std::copy(b, b + bn, y);
+		::std::size_t xn = an;
+		::std::size_t yn = bn;
+		for (;;) {
+			if (!yn) {
+				::std::copy(x, x + xn, r);
+				return xn;
+			}
+			if (xn < yn || (xn == yn && cmp(x, y, xn) < 0)) {
+				::std::swap(x, y);
+				::std::swap(xn, yn);
+			}
+			if (xn <= 2) {
+				const double_unit_t g = gcd_2(xn == 2 ? static_cast<double_unit_t>(x[1]) << unit_bit | x[0] : x[0],
+					yn == 2 ? static_cast<double_unit_t>(y[1]) << unit_bit | y[0] : y[0]);
+				r[0] = static_cast<unit_t>(g);
+				if (g >> unit_bit) {
+					r[1] = static_cast<unit_t>(g >> unit_bit);
+					return 2;
+				}
+				return 1;
+			}
+			if (yn == 1) {
+				r[0] = static_cast<unit_t>(gcd_2(y[0], divrem_1(tx, x, xn, y[0])));
+				return 1;
+			}
+			lehmer_matrix m;
+			if (lehmer_step(m, x, xn, y, yn)) {
+				::std::fill(y + yn, y + xn, unit_t{});
+				lehmer_apply(tx, xn, ty, yn, m, x, y, xn);
+				::std::swap(x, tx);
+				::std::swap(y, ty);
+			}
+			else {
+				// 商太大, 做一次完整的除法: (x, y) ← (y, x mod y)
+				divrem(tx, ty, x, xn, y, yn);
+				unit_t* const old = x;
+				x = y;
+				y = ty;
+				ty = old;
+				xn = yn;
+				yn = normalized_size(y, yn);
+			}
+		}
+	}
+
+}
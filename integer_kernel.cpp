@@ -0,0 +1,694 @@
+﻿#include"integer_kernel.h"
+#include<algorithm>
+#include<bit>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define C163Q_ADDCARRY 1
+#include<immintrin.h>
+#endif
+
+namespace C163q::kernel {
+
+	namespace {
+		// r = a + b + carry, 返回新的进位. x86-64上编译为adc链, 不经过double_unit_t
+		inline unsigned char add_carry(const unsigned char carry, const unit_t a, const unit_t b, unit_t& r) noexcept {
+#if defined(C163Q_ADDCARRY)
+			if constexpr (unit_bit == 32) {
+				unsigned int out;
+				const unsigned char next = _addcarry_u32(carry, static_cast<unsigned int>(a), static_cast<unsigned int>(b), &out);
+				r = out;
+				return next;
+			}
+			else {
+				unsigned long long out;
+				const unsigned char next = _addcarry_u64(carry, a, b, &out);
+				r = static_cast<unit_t>(out);
+				return next;
+			}
+#else
+			const unit_t sum = a + b;
+			r = sum + carry;
+			return static_cast<unsigned char>((sum < a) | (r < sum));
+#endif
+		}
+
+		// r = a - b - borrow, 返回新的借位. x86-64上编译为sbb链
+		inline unsigned char sub_borrow(const unsigned char borrow, const unit_t a, const unit_t b, unit_t& r) noexcept {
+#if defined(C163Q_ADDCARRY)
+			if constexpr (unit_bit == 32) {
+				unsigned int out;
+				const unsigned char next = _subborrow_u32(borrow, static_cast<unsigned int>(a), static_cast<unsigned int>(b), &out);
+				r = out;
+				return next;
+			}
+			else {
+				unsigned long long out;
+				const unsigned char next = _subborrow_u64(borrow, a, b, &out);
+				r = static_cast<unit_t>(out);
+				return next;
+			}
+#else
+			const unit_t diff = a - b;
+			r = diff - borrow;
+			return static_cast<unsigned char>((a < b) | (diff < borrow));
+#endif
+		}
+	}
+
+	[[nodiscard]] int cmp(const unit_t* a, const unit_t* b, ::std::size_t n) noexcept {
+		while (n--) {
+			if (a[n] != b[n]) return a[n] > b[n] ? 1 : -1;
+		}
+		return 0;
+	}
+
+	unit_t add_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept {
+		unsigned char carry{};
+		::std::size_t i{};
+		for (; i + 4 <= n; i += 4) {		// 展开4次, 进位在标志位中传递
+			carry = add_carry(carry, a[i], b[i], r[i]);
+			carry = add_carry(carry, a[i + 1], b[i + 1], r[i + 1]);
+			carry = add_carry(carry, a[i + 2], b[i + 2], r[i + 2]);
+			carry = add_carry(carry, a[i + 3], b[i + 3], r[i + 3]);
+		}
+		for (; i < n; ++i) {
+			carry = add_carry(carry, a[i], b[i], r[i]);
+		}
+		return carry;
+	}
+
+	unit_t add_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept {
+		::std::size_t i{};
+		for (; i < n && b; ++i) {
+			r[i] = a[i] + b;
+			b = (r[i] < b);		// 溢出时产生进位
+		}
+		if (r != a) {
+			::std::copy(a + i, a + n, r + i);
+		}
+		return b;
+	}
+
+	unit_t add(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept {
+		const unit_t carry = add_n(r, a, b, bn);
+		return add_1(r + bn, a + bn, an - bn, carry);
+	}
+
+	unit_t sub_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept {
+		unsigned char borrow{};
+		::std::size_t i{};
+		for (; i + 4 <= n; i += 4) {
+			borrow = sub_borrow(borrow, a[i], b[i], r[i]);
+			borrow = sub_borrow(borrow, a[i + 1], b[i + 1], r[i + 1]);
+			borrow = sub_borrow(borrow, a[i + 2], b[i + 2], r[i + 2]);
+			borrow = sub_borrow(borrow, a[i + 3], b[i + 3], r[i + 3]);
+		}
+		for (; i < n; ++i) {
+			borrow = sub_borrow(borrow, a[i], b[i], r[i]);
+		}
+		return borrow;
+	}
+
+	unit_t sub_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept {
+		::std::size_t i{};
+		for (; i < n && b; ++i) {
+			const unit_t ai = a[i];
+			r[i] = ai - b;
+			b = (ai < b);
+		}
+		if (r != a) {
+			::std::copy(a + i, a + n, r + i);
+		}
+		return b;
+	}
+
+	unit_t sub(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept {
+		const unit_t borrow = sub_n(r, a, b, bn);
+		return sub_1(r + bn, a + bn, an - bn, borrow);
+	}
+
+	unit_t mul_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept {
+		unit_t carry{};
+		for (::std::size_t i{}; i < n; ++i) {
+			const double_unit_t prod = static_cast<double_unit_t>(a[i]) * b + carry;
+			r[i] = integer_container::low_bit(prod);
+			carry = integer_container::high_bit(prod);
+		}
+		return carry;
+	}
+
+	unit_t addmul_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept {
+		unit_t carry{};
+		for (::std::size_t i{}; i < n; ++i) {
+			// a * b + r + carry <= (2^w - 1)^2 + 2 * (2^w - 1) = 2^2w - 1, 不会溢出
+			const double_unit_t prod = static_cast<double_unit_t>(a[i]) * b + r[i] + carry;
+			r[i] = integer_container::low_bit(prod);
+			carry = integer_container::high_bit(prod);
+		}
+		return carry;
+	}
+
+	unit_t submul_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept {
+		unit_t borrow{};
+		for (::std::size_t i{}; i < n; ++i) {
+			const double_unit_t prod = static_cast<double_unit_t>(a[i]) * b + borrow;
+			const unit_t low = integer_container::low_bit(prod);
+			borrow = integer_container::high_bit(prod) + (r[i] < low);
+			r[i] -= low;
+		}
+		return borrow;
+	}
+
+	unit_t addmul(unit_t* r, ::std::size_t rn, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) {
+		unit_t carry{};
+		if (bn < mul_karatsuba_threshold) {
+			// 每行的进位加到r的更高位上, 一般只传播一两个limb
+			for (::std::size_t j{}; j < bn; ++j) {
+				const unit_t row = addmul_1(r + j, a, an, b[j]);
+				carry += add_1(r + j + an, r + j + an, rn - j - an, row);
+			}
+			return carry;
+		}
+		const scratch_buffer<unit_t> prod(an + bn);
+		mul(prod.data(), a, an, b, bn);
+		return add(r, r, rn, prod.data(), an + bn);
+	}
+
+	unit_t submul(unit_t* r, ::std::size_t rn, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) {
+		unit_t borrow{};
+		if (bn < mul_karatsuba_threshold) {
+			for (::std::size_t j{}; j < bn; ++j) {
+				const unit_t row = submul_1(r + j, a, an, b[j]);
+				borrow += sub_1(r + j + an, r + j + an, rn - j - an, row);
+			}
+			return borrow;
+		}
+		const scratch_buffer<unit_t> prod(an + bn);
+		mul(prod.data(), a, an, b, bn);
+		return sub(r, r, rn, prod.data(), an + bn);
+	}
+
+	void mul_basecase(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept {
+		r[an] = mul_1(r, a, an, b[0]);
+		for (::std::size_t j{ 1 }; j < bn; ++j) {
+			r[an + j] = addmul_1(r + j, a, an, b[j]);
+		}
+	}
+
+	void sqr_basecase(unit_t* r, const unit_t* a, ::std::size_t n) noexcept {
+		// 先求交叉项之和 sum(a[i] * a[j] * B^(i+j)), i < j
+		r[0] = 0;
+		r[n] = mul_1(r + 1, a + 1, n - 1, a[0]);
+		for (::std::size_t i{ 1 }; i + 1 < n; ++i) {
+			r[n + i] = addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+		}
+		r[2 * n - 1] = 0;
+		// 交叉项乘2, 再加上对角项a[i]^2
+		lshift(r, r, 2 * n, 1);
+		unit_t carry{};
+		for (::std::size_t i{}; i < n; ++i) {
+			const double_unit_t square = static_cast<double_unit_t>(a[i]) * a[i];
+			double_unit_t sum = static_cast<double_unit_t>(r[2 * i]) + integer_container::low_bit(square) + carry;
+			r[2 * i] = integer_container::low_bit(sum);
+			sum = static_cast<double_unit_t>(r[2 * i + 1]) + integer_container::high_bit(square) + integer_container::high_bit(sum);
+			r[2 * i + 1] = integer_container::low_bit(sum);
+			carry = integer_container::high_bit(sum);
+		}
+	}
+
+	namespace {
+		// Karatsuba至少要把n拆成两段非空, Toom-3至少要把n拆成三段非空
+		[[nodiscard]] ::std::size_t karatsuba_threshold() noexcept {
+			return ::std::max<::std::size_t>(mul_karatsuba_threshold, 2);
+		}
+
+		[[nodiscard]] ::std::size_t toom3_threshold() noexcept {
+			return ::std::max<::std::size_t>(mul_toom3_threshold, 16);
+		}
+
+		[[nodiscard]] ::std::size_t ntt_threshold() noexcept {
+			return ::std::max<::std::size_t>(mul_ntt_threshold, 16);
+		}
+
+		[[nodiscard]] ::std::size_t sqr_karatsuba_threshold_clamped() noexcept {
+			return ::std::max<::std::size_t>(sqr_karatsuba_threshold, 2);
+		}
+
+		[[nodiscard]] ::std::size_t sqr_toom3_threshold_clamped() noexcept {
+			return ::std::max<::std::size_t>(sqr_toom3_threshold, 16);
+		}
+
+		[[nodiscard]] ::std::size_t sqr_ntt_threshold_clamped() noexcept {
+			return ::std::max<::std::size_t>(sqr_ntt_threshold, 16);
+		}
+
+		// 长度为n的Karatsuba乘法所需的临时空间(含递归)
+		[[nodiscard]] ::std::size_t karatsuba_scratch_size(::std::size_t n) noexcept {
+			::std::size_t ret{};
+			while (n >= karatsuba_threshold()) {
+				const ::std::size_t h = n - n / 2;
+				ret += 6 * h + 1;
+				n = h;
+			}
+			return ret;
+		}
+
+		// r[0..h) = |lo[0..k) - hi[0..h)|, 返回lo < hi. Note: h == k 或 h == k + 1
+		bool abs_diff(unit_t* r, const unit_t* lo, ::std::size_t k, const unit_t* hi, ::std::size_t h) noexcept {
+			if (h > k) {
+				if (hi[k]) {
+					sub(r, hi, h, lo, k);
+					return true;
+				}
+				r[k] = 0;
+			}
+			if (cmp(lo, hi, k) >= 0) {
+				sub_n(r, lo, hi, k);
+				return false;
+			}
+			sub_n(r, hi, lo, k);
+			return true;
+		}
+
+		void karatsuba_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n, unit_t* ws);
+
+		void mul_n_ws(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n, unit_t* ws) {
+			if (n < karatsuba_threshold()) {
+				mul_basecase(r, a, n, b, n);
+			}
+			else {
+				karatsuba_n(r, a, b, n, ws);
+			}
+		}
+
+		// a = a1 * x + a0, b = b1 * x + b0, x = B^k
+		// a * b = a1b1 * x^2 + (a0b0 + a1b1 - (a0 - a1)(b0 - b1)) * x + a0b0
+		void karatsuba_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n, unit_t* ws) {
+			const ::std::size_t k = n / 2;
+			const ::std::size_t h = n - k;
+			unit_t* const da = ws;				// |a0 - a1|, h limb
+			unit_t* const db = ws + h;			// |b0 - b1|, h limb
+			unit_t* const t = ws + 2 * h;		// da * db, 2h limb
+			unit_t* const u = ws + 4 * h;		// a0b0 + a1b1, 2h + 1 limb
+			unit_t* const next = ws + 6 * h + 1;
+			const bool a_neg = abs_diff(da, a, k, a + k, h);
+			const bool b_neg = abs_diff(db, b, k, b + k, h);
+			mul_n_ws(t, da, db, h, next);
+			mul_n_ws(r, a, b, k, next);
+			mul_n_ws(r + 2 * k, a + k, b + k, h, next);
+			u[2 * h] = add(u, r + 2 * k, 2 * h, r, 2 * k);
+			if (a_neg == b_neg) {
+				sub(u, u, 2 * h + 1, t, 2 * h);
+			}
+			else {
+				add(u, u, 2 * h + 1, t, 2 * h);
+			}
+			add(r + k, r + k, 2 * n - k, u, 2 * h + 1);
+		}
+
+		// 去除高位的0后的长度
+		[[nodiscard]] ::std::size_t significant(const unit_t* a, ::std::size_t n) noexcept {
+			while (n && !a[n - 1]) --n;
+			return n;
+		}
+
+		// 以n limb的补码形式求相反数
+		void negate(unit_t* r, ::std::size_t n) noexcept {
+			for (::std::size_t i{}; i < n; ++i) r[i] = ~r[i];
+			add_1(r, r, n, 1);
+		}
+
+		// n limb的补码算术右移1位
+		void shift_right_1_signed(unit_t* r, ::std::size_t n) noexcept {
+			const unit_t sign = r[n - 1] & (static_cast<unit_t>(1U) << (unit_bit - 1));
+			for (::std::size_t i{}; i + 1 < n; ++i) {
+				r[i] = (r[i] >> 1) | (r[i + 1] << (unit_bit - 1));
+			}
+			r[n - 1] = (r[n - 1] >> 1) | sign;
+		}
+
+		// r[0..n) = a[0..n) / 3 (mod B^n), 要求a是3的倍数(补码亦可)
+		void divexact_by3(unit_t* r, const unit_t* a, ::std::size_t n) noexcept {
+			constexpr unit_t inv3 = integer_container::unit_max / 3 * 2 + 1;	// 3 * inv3 == 1 (mod B)
+			unit_t carry{};
+			for (::std::size_t i{}; i < n; ++i) {
+				const unit_t ai = a[i];
+				const unit_t borrow = (ai < carry);
+				const unit_t q = static_cast<unit_t>((ai - carry) * inv3);
+				r[i] = q;
+				carry = integer_container::high_bit(static_cast<double_unit_t>(q) * 3) + borrow;
+			}
+		}
+
+		// 计算Toom-3在1, -1, 2处的取值: a(x) = a0 + a1 * x + a2 * x^2, 其中a0, a1为k limb, a2为l limb
+		// e1 = a(1), em1 = |a(-1)|, e2 = a(2), 均为k + 1 limb. 返回a(-1) < 0
+		bool toom3_eval(unit_t* e1, unit_t* em1, unit_t* e2, const unit_t* a, ::std::size_t k, ::std::size_t l) noexcept {
+			const unit_t* const a0 = a;
+			const unit_t* const a1 = a + k;
+			const unit_t* const a2 = a + 2 * k;
+			e1[k] = add(e1, a0, k, a2, l);		// a0 + a2
+			bool neg{};
+			if (e1[k] || cmp(e1, a1, k) >= 0) {
+				em1[k] = e1[k] - sub_n(em1, e1, a1, k);
+			}
+			else {
+				sub_n(em1, a1, e1, k);
+				em1[k] = 0;
+				neg = true;
+			}
+			e1[k] += add_n(e1, e1, a1, k);
+			// a(2) = ((a2 * 2) + a1) * 2 + a0
+			::std::fill(::std::copy(a2, a2 + l, e2), e2 + k + 1, 0);
+			mul_1(e2, e2, k + 1, 2);
+			add(e2, e2, k + 1, a1, k);
+			mul_1(e2, e2, k + 1, 2);
+			add(e2, e2, k + 1, a0, k);
+			return neg;
+		}
+
+		// 把v[0..n)的有效部分加到r[off..rn)中
+		void add_at(unit_t* r, ::std::size_t rn, ::std::size_t off, const unit_t* v, ::std::size_t n) noexcept {
+			n = significant(v, n);
+			if (n) add(r + off, r + off, rn - off, v, n);
+		}
+
+		// Toom-3插值. p1 = p(1), pm1 = p(-1)(补码), p2 = p(2)均为w = 2k + 2 limb,
+		// r[0..2k)中已有c0, r[4k..2n)中已有c4, 求出c1, c2, c3并累加到r中. work至少3w limb
+		void toom3_interpolate(unit_t* r, ::std::size_t n, ::std::size_t k, unit_t* p1, unit_t* pm1, unit_t* p2, unit_t* work) noexcept {
+			const ::std::size_t w = 2 * k + 2;
+			unit_t* const r0 = work;
+			unit_t* const r4 = r0 + w;
+			unit_t* const tmp = r4 + w;
+			::std::fill(::std::copy(r, r + 2 * k, r0), r0 + w, 0);
+			::std::fill(::std::copy(r + 4 * k, r + 2 * n, r4), r4 + w, 0);
+
+			// 以下均为w limb的补码运算, 舍弃最高位的进位/借位
+			// c2 = (p(1) + p(-1)) / 2 - c0 - c4, 存放于p1中
+			// s = c1 + c3 = (p(1) - p(-1)) / 2, 存放于pm1中
+			sub_n(tmp, p1, pm1, w);
+			add_n(p1, p1, pm1, w);
+			shift_right_1_signed(p1, w);
+			sub_n(p1, p1, r0, w);
+			sub_n(p1, p1, r4, w);
+			unit_t* const c2 = p1;
+			shift_right_1_signed(tmp, w);
+			::std::copy(tmp, tmp + w, pm1);
+			unit_t* const s = pm1;
+			// c3 = (p(2) - c0 - 4 * c2 - 16 * c4 - 2 * s) / 6
+			sub_n(p2, p2, r0, w);
+			mul_1(tmp, r4, w, 16);
+			sub_n(p2, p2, tmp, w);
+			mul_1(tmp, c2, w, 4);
+			sub_n(p2, p2, tmp, w);
+			mul_1(tmp, s, w, 2);
+			sub_n(p2, p2, tmp, w);
+			shift_right_1_signed(p2, w);
+			divexact_by3(p2, p2, w);
+			unit_t* const c3 = p2;
+			// c1 = s - c3
+			sub_n(s, s, c3, w);
+			unit_t* const c1 = s;
+
+			::std::fill(r + 2 * k, r + 4 * k, 0);
+			add_at(r, 2 * n, k, c1, w);
+			add_at(r, 2 * n, 2 * k, c2, w);
+			add_at(r, 2 * n, 3 * k, c3, w);
+		}
+
+		// 取值点为0, 1, -1, 2, ∞的Toom-3乘法. r[0..2n) = a[0..n) * b[0..n)
+		void toom3_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) {
+			const ::std::size_t k = (n + 2) / 3;		// 每段的长度
+			const ::std::size_t l = n - 2 * k;		// 最高段的长度, 1 <= l <= k
+			const ::std::size_t e = k + 1;			// 取值的长度
+			const ::std::size_t w = 2 * e;			// 插值时补码运算的宽度
+			scratch_buffer<unit_t> buf(6 * e + 6 * w);
+			unit_t* const ea1 = buf.data();
+			unit_t* const eam1 = ea1 + e;
+			unit_t* const ea2 = eam1 + e;
+			unit_t* const eb1 = ea2 + e;
+			unit_t* const ebm1 = eb1 + e;
+			unit_t* const eb2 = ebm1 + e;
+			unit_t* const p1 = eb2 + e;
+			unit_t* const pm1 = p1 + w;
+			unit_t* const p2 = pm1 + w;
+
+			const bool neg = toom3_eval(ea1, eam1, ea2, a, k, l) != toom3_eval(eb1, ebm1, eb2, b, k, l);
+			mul_n(p1, ea1, eb1, e);
+			mul_n(pm1, eam1, ebm1, e);
+			if (neg) negate(pm1, w);
+			mul_n(p2, ea2, eb2, e);
+			mul_n(r, a, b, k);								// a0 * b0
+			mul_n(r + 4 * k, a + 2 * k, b + 2 * k, l);		// a2 * b2
+			toom3_interpolate(r, n, k, p1, pm1, p2, p2 + w);
+		}
+
+		// Toom-3平方, p(-1) = a(-1)^2总是非负. r[0..2n) = a[0..n)^2
+		void toom3_sqr_n(unit_t* r, const unit_t* a, ::std::size_t n) {
+			const ::std::size_t k = (n + 2) / 3;
+			const ::std::size_t l = n - 2 * k;
+			const ::std::size_t e = k + 1;
+			const ::std::size_t w = 2 * e;
+			scratch_buffer<unit_t> buf(3 * e + 6 * w);
+			unit_t* const ea1 = buf.data();
+			unit_t* const eam1 = ea1 + e;
+			unit_t* const ea2 = eam1 + e;
+			unit_t* const p1 = ea2 + e;
+			unit_t* const pm1 = p1 + w;
+			unit_t* const p2 = pm1 + w;
+
+			toom3_eval(ea1, eam1, ea2, a, k, l);
+			sqr(p1, ea1, e);
+			sqr(pm1, eam1, e);
+			sqr(p2, ea2, e);
+			sqr(r, a, k);
+			sqr(r + 4 * k, a + 2 * k, l);
+			toom3_interpolate(r, n, k, p1, pm1, p2, p2 + w);
+		}
+
+		// 长度为n的Karatsuba平方所需的临时空间(含递归)
+		[[nodiscard]] ::std::size_t karatsuba_sqr_scratch_size(::std::size_t n) noexcept {
+			::std::size_t ret{};
+			while (n >= sqr_karatsuba_threshold_clamped()) {
+				const ::std::size_t h = n - n / 2;
+				ret += 5 * h + 1;
+				n = h;
+			}
+			return ret;
+		}
+
+		void karatsuba_sqr_n(unit_t* r, const unit_t* a, ::std::size_t n, unit_t* ws);
+
+		void sqr_n_ws(unit_t* r, const unit_t* a, ::std::size_t n, unit_t* ws) {
+			if (n < sqr_karatsuba_threshold_clamped()) {
+				sqr_basecase(r, a, n);
+			}
+			else {
+				karatsuba_sqr_n(r, a, n, ws);
+			}
+		}
+
+		// a^2 = a1^2 * x^2 + (a0^2 + a1^2 - (a0 - a1)^2) * x + a0^2
+		void karatsuba_sqr_n(unit_t* r, const unit_t* a, ::std::size_t n, unit_t* ws) {
+			const ::std::size_t k = n / 2;
+			const ::std::size_t h = n - k;
+			unit_t* const da = ws;				// |a0 - a1|, h limb
+			unit_t* const t = ws + h;			// da^2, 2h limb
+			unit_t* const u = ws + 3 * h;		// a0^2 + a1^2, 2h + 1 limb
+			unit_t* const next = ws + 5 * h + 1;
+			abs_diff(da, a, k, a + k, h);
+			sqr_n_ws(t, da, h, next);
+			sqr_n_ws(r, a, k, next);
+			sqr_n_ws(r + 2 * k, a + k, h, next);
+			u[2 * h] = add(u, r + 2 * k, 2 * h, r, 2 * k);
+			sub(u, u, 2 * h + 1, t, 2 * h);
+			add(r + k, r + k, 2 * n - k, u, 2 * h + 1);
+		}
+	}
+
+	void mul_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) {
+		if (n < karatsuba_threshold()) {
+			mul_basecase(r, a, n, b, n);
+		}
+		else if (n < toom3_threshold()) {
+			scratch_buffer<unit_t> ws(karatsuba_scratch_size(n));
+			karatsuba_n(r, a, b, n, ws.data());
+		}
+		else if (n < ntt_threshold() || !mul_ntt(r, a, n, b, n)) {
+			toom3_n(r, a, b, n);	// 超出NTT长度上限时由Toom-3拆分到NTT能处理的规模
+		}
+	}
+
+	void sqr(unit_t* r, const unit_t* a, ::std::size_t n) {
+		if (n < sqr_karatsuba_threshold_clamped()) {
+			sqr_basecase(r, a, n);
+		}
+		else if (n < sqr_toom3_threshold_clamped()) {
+			scratch_buffer<unit_t> ws(karatsuba_sqr_scratch_size(n));
+			karatsuba_sqr_n(r, a, n, ws.data());
+		}
+		else if (n < sqr_ntt_threshold_clamped() || !mul_ntt(r, a, n, a, n)) {
+			toom3_sqr_n(r, a, n);
+		}
+	}
+
+	void mul(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) {
+		if (bn < karatsuba_threshold()) {
+			mul_basecase(r, a, an, b, bn);
+			return;
+		}
+		if (an == bn) {
+			mul_n(r, a, b, bn);
+			return;
+		}
+		if (bn >= ntt_threshold() && mul_ntt(r, a, an, b, bn)) {
+			return;
+		}
+		// 不平衡的情况: 将a按bn limb分块, 每块与b做平衡乘法后累加
+		mul_n(r, a, b, bn);
+		scratch_buffer<unit_t> tmp(2 * bn);
+		::std::size_t i{ bn };
+		for (; i + bn <= an; i += bn) {
+			mul_n(tmp.data(), a + i, b, bn);
+			const unit_t carry = add_n(r + i, r + i, tmp.data(), bn);
+			add_1(r + i + bn, tmp.data() + bn, bn, carry);
+		}
+		if (i < an) {
+			const ::std::size_t rest = an - i;
+			mul(tmp.data(), b, bn, a + i, rest);
+			const unit_t carry = add_n(r + i, r + i, tmp.data(), bn);
+			add_1(r + i + bn, tmp.data() + bn, rest, carry);
+		}
+	}
+
+	unit_t divrem_1(unit_t* q, const unit_t* a, ::std::size_t n, unit_t d) noexcept {
+		double_unit_t rem{};
+		for (::std::size_t i{ n }; i--;) {
+			rem = integer_container::combine_bit(static_cast<unit_t>(rem), a[i]);
+			q[i] = static_cast<unit_t>(rem / d);
+			rem %= d;
+		}
+		return static_cast<unit_t>(rem);
+	}
+
+	unit_t mod_1(const unit_t* a, ::std::size_t n, unit_t d) noexcept {
+		double_unit_t rem{};
+		for (::std::size_t i{ n }; i--;) {
+			rem = integer_container::combine_bit(static_cast<unit_t>(rem), a[i]) % d;
+		}
+		return static_cast<unit_t>(rem);
+	}
+
+	void divrem_basecase(unit_t* q, unit_t* np, ::std::size_t nn, const unit_t* dp, ::std::size_t dn) noexcept {
+		const unit_t d1 = dp[dn - 1];
+		const unit_t d0 = dp[dn - 2];
+		for (::std::size_t j{ nn - dn }; j--;) {
+			// 用被除数最高的两个limb除以除数最高的limb估计商, 再用次高limb修正.
+			// 除数已规格化, 修正后的估计值至多比真实的商大1
+			const double_unit_t top = integer_container::combine_bit(np[j + dn], np[j + dn - 1]);
+			double_unit_t qhat = top / d1;
+			double_unit_t rhat = top % d1;
+			while (qhat > integer_container::unit_max
+				|| qhat * d0 > integer_container::combine_bit(static_cast<unit_t>(rhat), np[j + dn - 2])) {
+				--qhat;
+				rhat += d1;
+				if (rhat > integer_container::unit_max) break;
+			}
+			const unit_t borrow = submul_1(np + j, dp, dn, static_cast<unit_t>(qhat));
+			if (np[j + dn] < borrow) {	// 估计值大了1, 加回一个除数
+				--qhat;
+				add_n(np + j, np + j, dp, dn);
+			}
+			np[j + dn] = 0;
+			q[j] = static_cast<unit_t>(qhat);
+		}
+	}
+
+	namespace {
+		void div_block(unit_t* q, unit_t* np, const unit_t* dp, ::std::size_t dn, ::std::size_t k, unit_t* tp);
+
+		// 2k limb除以k limb, 分两半递归. 要求np[k..2k) < dp
+		void div_2k_by_k(unit_t* q, unit_t* np, const unit_t* dp, ::std::size_t k, unit_t* tp) {
+			const ::std::size_t lo = k / 2;
+			const ::std::size_t hi = k - lo;
+			div_block(q + lo, np + lo, dp, k, hi, tp);
+			div_block(q, np, dp, k, lo, tp);
+		}
+
+		// Burnikel-Ziegler: np[0..dn+k)除以已规格化的dp[0..dn), 商写入q[0..k), 余数留在np[0..dn).
+		// 要求np[k..k+dn) < dp, 1 <= k <= dn. tp至少dn limb
+		// 先用除数的高k limb递归求出商(至多大2), 再减去商与除数低dn-k limb之积并修正
+		void div_block(unit_t* q, unit_t* np, const unit_t* dp, ::std::size_t dn, ::std::size_t k, unit_t* tp) {
+			if (k < ::std::max<::std::size_t>(div_dc_threshold, 2)) {
+				divrem_basecase(q, np, dn + k, dp, dn);
+				return;
+			}
+			const unit_t* const dh = dp + dn - k;
+			unit_t* const ah = np + dn - k;		// 2k limb
+			if (cmp(ah + k, dh, k) == 0) {
+				// 高k limb相等时商的估计值取B^k - 1, 余数为ah[0..k) + dh
+				::std::fill(q, q + k, integer_container::unit_max);
+				::std::fill(ah + k, ah + 2 * k, 0);
+				ah[k] = add_n(ah, ah, dh, k);
+			}
+			else {
+				div_2k_by_k(q, ah, dh, k, tp);
+			}
+			if (dn == k) return;
+			const ::std::size_t ln = dn - k;
+			if (k >= ln) {
+				mul(tp, q, k, dp, ln);
+			}
+			else {
+				mul(tp, dp, ln, q, k);
+			}
+			int top = static_cast<int>(np[dn]) - static_cast<int>(sub_n(np, np, tp, dn));
+			while (top < 0) {		// 余数为负: 商减1并加回除数, 至多两次
+				sub_1(q, q, k, 1);
+				top += static_cast<int>(add_n(np, np, dp, dn));
+			}
+			np[dn] = 0;
+		}
+	}
+
+	void divrem(unit_t* q, unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* d, ::std::size_t dn) {
+		if (dn == 1) {
+			r[0] = divrem_1(q, a, an, d[0]);
+			return;
+		}
+		// 规格化: 左移使除数最高位为1, 被除数多出一个limb以容纳移出的位
+		const unsigned shift = static_cast<unsigned>(::std::countl_zero(d[dn - 1]));
+		scratch_buffer<unit_t> buf(an + 1 + dn);
+		unit_t* const np = buf.data();
+		unit_t* const dp = np + an + 1;
+		if (shift) {
+			lshift(dp, d, dn, shift);
+			np[an] = lshift(np, a, an, shift);
+		}
+		else {
+			::std::copy(d, d + dn, dp);
+			::std::copy(a, a + an, np);
+		}
+		const ::std::size_t qn = an + 1 - dn;
+		if (dn < ::std::max<::std::size_t>(div_dc_threshold, 2) || qn < div_dc_threshold) {
+			divrem_basecase(q, np, an + 1, dp, dn);
+		}
+		else {
+			// 从高位起每次求出(至多)dn limb的商, 每块的余数作为下一块被除数的高位
+			scratch_buffer<unit_t> tp(dn);
+			::std::size_t j{ qn };
+			::std::size_t k{ qn % dn ? qn % dn : dn };
+			while (j) {
+				j -= k;
+				div_block(q + j, np + j, dp, dn, k, tp.data());
+				k = dn;
+			}
+		}
+		if (shift) {
+			rshift(r, np, dn, shift);
+		}
+		else {
+			::std::copy(np, np + dn, r);
+		}
+	}
+
+}
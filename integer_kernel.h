@@ -0,0 +1,238 @@
+﻿#pragma once
+#include<algorithm>
+#include<cstddef>
+#include<utility>
+#include"integer_container.h"
+
+
+/// @brief 直接作用于limb数组(低位在前, 与`integer_container`的布局一致)的底层运算,
+/// 供`integer`的乘除法等引擎复用.
+/// @note 除特别说明外, 输出数组不得与输入数组重叠; 所有长度均以`unit_t`为单位.
+namespace C163q::kernel {
+	using unit_t = integer_container::unit_t;
+	using double_unit_t = integer_container::double_unit_t;
+	constexpr unsigned unit_bit = integer_container::unit_bit;
+
+	// 乘法算法切换阈值(limb数). 低于`mul_karatsuba_threshold`使用逐行乘法,
+	// 低于`mul_toom3_threshold`使用Karatsuba, 低于`mul_ntt_threshold`使用Toom-3, 否则使用NTT.
+	// 可在运行时针对平台调整.
+	inline ::std::size_t mul_karatsuba_threshold{ 32 };
+	inline ::std::size_t mul_toom3_threshold{ 200 };
+	inline ::std::size_t mul_ntt_threshold{ 7000 };
+
+	// 平方算法的切换阈值, 含义同上
+	inline ::std::size_t sqr_karatsuba_threshold{ 48 };
+	inline ::std::size_t sqr_toom3_threshold{ 300 };
+	inline ::std::size_t sqr_ntt_threshold{ 6000 };
+
+	// 除数与商都不少于该limb数时, 除法使用Burnikel-Ziegler分治算法, 否则使用Knuth算法D
+	inline ::std::size_t div_dc_threshold{ 60 };
+
+	// 模数不少于该limb数时, Montgomery约化用两次整块乘法代替逐limb约化
+	inline ::std::size_t redc_dc_threshold{ 64 };
+
+	// 两数都不少于该limb数时, gcd与xgcd先用半GCD(分治)约化, 否则直接用Lehmer算法.
+	// 半GCD每层要约去的位数不超过`hgcd_basecase_threshold`个limb时不再递归
+	inline ::std::size_t gcd_dc_threshold{ 300 };
+	inline ::std::size_t hgcd_basecase_threshold{ 30 };
+
+	// 进制转换(输出与解析)中, 不少于该limb数时按base^(k*2^i)分治, 否则逐块除以(乘以)base^k
+	inline ::std::size_t radix_dc_threshold{ 30 };
+
+	// 每个线程的临时缓冲池最多缓存的字节数, 超出的块归还时直接释放
+	inline ::std::size_t scratch_cache_limit{ ::std::size_t{ 64 } << 20 };
+
+	/// @brief 临时缓冲池的统计(当前线程). hits为直接复用缓存块的次数, misses为需要向堆申请的次数
+	struct scratch_statistics {
+		::std::size_t hits;
+		::std::size_t misses;
+	};
+
+	[[nodiscard]] scratch_statistics scratch_stats() noexcept;
+
+	void reset_scratch_stats() noexcept;
+
+	// 释放当前线程缓存的所有块
+	void release_scratch() noexcept;
+
+	// 从当前线程的缓冲池借出至少bytes字节的块(按2的幂分级), level返回块的级别, 归还时原样传回
+	[[nodiscard]] void* scratch_acquire(::std::size_t bytes, unsigned& level);
+
+	void scratch_release(void* block, unsigned level) noexcept;
+
+	/// @brief 从线程局部缓冲池借出n个元素(已清零)的临时数组, 析构时归还.
+	/// 乘除法与进制转换的中间结果都使用它, 使相同规模的运算在稳定后不再分配内存.
+	template<class T>
+	class scratch_buffer {
+	private:
+		T* ptr;
+		unsigned level;
+
+	public:
+		explicit scratch_buffer(const ::std::size_t n) : ptr(static_cast<T*>(scratch_acquire(n * sizeof(T), level))) {
+			::std::fill(ptr, ptr + n, T{});
+		}
+
+		scratch_buffer(scratch_buffer&& other) noexcept : ptr(::std::exchange(other.ptr, nullptr)), level(other.level) {}
+
+		scratch_buffer(const scratch_buffer&) = delete;
+		scratch_buffer& operator=(const scratch_buffer&) = delete;
+		scratch_buffer& operator=(scratch_buffer&&) = delete;
+
+		~scratch_buffer() {
+			if (ptr) scratch_release(ptr, level);
+		}
+
+		[[nodiscard]] T* data() const noexcept {
+			return ptr;
+		}
+
+		[[nodiscard]] T& operator[](const ::std::size_t i) const noexcept {
+			return ptr[i];
+		}
+	};
+
+	// 从高位开始比较a[0..n)与b[0..n), 返回-1, 0, 1
+	[[nodiscard]] int cmp(const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r[0..n) = a[0..n) + b[0..n), 返回进位. 无分支, x86-64上使用进位链指令. r可以与a或b相同
+	unit_t add_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r[0..n) = a[0..n) + b, 返回进位. r可以与a相同
+	unit_t add_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept;
+
+	// r[0..an) = a[0..an) + b[0..bn), 返回进位. 高位部分在进位消失后直接复制(r与a相同时直接返回).
+	// Note: an >= bn, r可以与a相同, 也可以与b相同
+	unit_t add(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept;
+
+	// r[0..n) = a[0..n) - b[0..n), 返回借位. 无分支, x86-64上使用借位链指令. r可以与a或b相同
+	unit_t sub_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r[0..n) = a[0..n) - b, 返回借位. r可以与a相同
+	unit_t sub_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept;
+
+	// r[0..an) = a[0..an) - b[0..bn), 返回借位. 高位部分的处理同`add`. Note: an >= bn, r可以与a相同, 也可以与b相同
+	unit_t sub(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept;
+
+	/// @brief 按位运算与移位所用的指令集. x86-64上默认按CPU在SSE2与AVX2中选择, AArch64上为NEON;
+	/// 定义`C163Q_NO_SIMD`或在其他平台上时只有portable(逐limb)
+	enum class simd_isa { portable, sse2, avx2, neon };
+
+	// 当前平台与CPU支持的最高指令集
+	[[nodiscard]] simd_isa simd_support() noexcept;
+
+	// 当前使用的指令集
+	[[nodiscard]] simd_isa simd_level() noexcept;
+
+	// 改用指定的指令集(便于测试与对比), 不支持时返回false且不做修改. 应在其他线程开始运算前调用
+	bool set_simd_level(simd_isa isa) noexcept;
+
+	// r[0..n) = a[0..n) & b[0..n). r可以与a或b相同
+	void and_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r[0..n) = a[0..n) | b[0..n). r可以与a或b相同
+	void ior_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r[0..n) = a[0..n) ^ b[0..n). r可以与a或b相同
+	void xor_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r[0..n) = a[0..n) << bit, 返回移出的高位. Note: n >= 1, 0 < bit < unit_bit, 允许重叠但要求r >= a
+	unit_t lshift(unit_t* r, const unit_t* a, ::std::size_t n, unsigned bit) noexcept;
+
+	// r[0..n) = a[0..n) >> bit, 返回移出的低位(位于返回值的高位). Note: n >= 1, 0 < bit < unit_bit, 允许重叠但要求r <= a
+	unit_t rshift(unit_t* r, const unit_t* a, ::std::size_t n, unsigned bit) noexcept;
+
+	// r[0..n) = a[0..n) * b, 返回最高位的进位. r可以与a相同
+	unit_t mul_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept;
+
+	// r[0..n) += a[0..n) * b, 返回最高位的进位
+	unit_t addmul_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept;
+
+	// r[0..n) -= a[0..n) * b, 返回最高位的借位
+	unit_t submul_1(unit_t* r, const unit_t* a, ::std::size_t n, unit_t b) noexcept;
+
+	// r[0..rn) += a[0..an) * b[0..bn), 返回进位. bn低于`mul_karatsuba_threshold`时逐行直接累加到r中,
+	// 否则在临时缓冲区中求积后相加. Note: an >= bn >= 1, rn >= an + bn, r不能与a或b重叠
+	unit_t addmul(unit_t* r, ::std::size_t rn, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn);
+
+	// r[0..rn) -= a[0..an) * b[0..bn), 返回借位, 其余同`addmul`
+	unit_t submul(unit_t* r, ::std::size_t rn, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn);
+
+	// r[0..an+bn) = a[0..an) * b[0..bn), 逐行乘法. Note: an >= bn >= 1
+	void mul_basecase(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept;
+
+	// r[0..2n) = a[0..n)^2, 利用对称性只计算一半的交叉项. Note: n >= 1
+	void sqr_basecase(unit_t* r, const unit_t* a, ::std::size_t n) noexcept;
+
+	// r[0..2n) = a[0..n) * b[0..n), 按阈值选择逐行乘法/Karatsuba/Toom-3. Note: n >= 1
+	void mul_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n);
+
+	// r[0..an+bn) = a[0..an) * b[0..bn). Note: an >= bn >= 1
+	void mul(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn);
+
+	// r[0..2n) = a[0..n)^2, 按`sqr_*_threshold`选择各层的平方算法. Note: n >= 1
+	void sqr(unit_t* r, const unit_t* a, ::std::size_t n);
+
+	// q[0..n) = a[0..n) / d, 返回余数. q可以与a相同
+	unit_t divrem_1(unit_t* q, const unit_t* a, ::std::size_t n, unit_t d) noexcept;
+
+	// 返回a[0..n) % d, 不写出商
+	[[nodiscard]] unit_t mod_1(const unit_t* a, ::std::size_t n, unit_t d) noexcept;
+
+	// Knuth算法D, 每步求出一个limb的商. 要求dp已规格化(dp[dn-1]最高位为1), dn >= 2,
+	// 且np[nn-dn..nn) < dp. q[0..nn-dn) = np / dp, 余数留在np[0..dn), np的其余部分被清零
+	void divrem_basecase(unit_t* q, unit_t* np, ::std::size_t nn, const unit_t* dp, ::std::size_t dn) noexcept;
+
+	// q[0..an-dn+1) = a / d, r[0..dn) = a % d, 按`div_dc_threshold`选择算法. Note: an >= dn >= 1, d[dn-1] != 0
+	void divrem(unit_t* q, unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* d, ::std::size_t dn);
+
+	/// @brief Lehmer算法累积的2x2余因子矩阵, 只记录元素的绝对值. odd为false时
+	/// (a, b) ← (m00 * a - m01 * b, m11 * b - m10 * a), 否则(a, b) ← (m01 * b - m00 * a, m10 * a - m11 * b)
+	struct lehmer_matrix {
+		unit_t m00;
+		unit_t m01;
+		unit_t m10;
+		unit_t m11;
+		bool odd;
+	};
+
+	// Stein二进制算法求a与b的最大公因数, 其中一个为0时返回另一个
+	[[nodiscard]] double_unit_t gcd_2(double_unit_t a, double_unit_t b) noexcept;
+
+	// 只看a与b最高的2 * unit_bit - 1位模拟Euclid算法, 把商可以确定的若干步累积到m中(余因子不超过unit_max).
+	// 返回false表示第一步的商就无法确定(或商超过unit_max), 此时应做一次完整的除法.
+	// Note: a >= b, an >= bn, a[an-1] != 0
+	bool lehmer_step(lehmer_matrix& m, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) noexcept;
+
+	// 把m作用于a[0..n)与b[0..n)(b用0补齐到n个limb), 结果写入ra[0..n]与rb[0..n], ran与rbn返回去掉前导0后的长度.
+	// Note: 输出不能与输入重叠
+	void lehmer_apply(unit_t* ra, ::std::size_t& ran, unit_t* rb, ::std::size_t& rbn,
+		const lehmer_matrix& m, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept;
+
+	// r = gcd(a[0..an), b[0..bn)), 返回r的limb数. 都不超过两个limb时用`gcd_2`, 否则用Lehmer算法.
+	// Note: an, bn >= 1, a[an-1] != 0, b[bn-1] != 0, r至少要有min(an, bn)个limb的空间
+	::std::size_t gcd(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn);
+
+	// r[0..an+bn) = a[0..an) * b[0..bn), 三素数NTT卷积. 规模超出变换长度上限时不做任何事并返回false.
+	// a与b为同一数组时只做一次正变换(平方)
+	bool mul_ntt(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn);
+
+	// 返回字符c作为数字的值('0'-'9', 'a'-'z', 'A'-'Z'分别对应0-35), 不是数字时返回36
+	[[nodiscard]] unsigned digit_value(char c) noexcept;
+
+	// 写出a[0..n)的base进制表示所需字符数(不含符号). base为2的幂时为精确值, 否则为上界. Note: 2 <= base <= 36
+	[[nodiscard]] ::std::size_t to_chars_length(const unit_t* a, ::std::size_t n, unsigned base) noexcept;
+
+	// 把a[0..n)写成base进制的数字('0'-'9', 'a'-'z', 无前导0), 返回写入的字符数. base为2的幂时按位切分, 代价为线性.
+	// Note: first至少要有to_chars_length(a, n, base)个字符的空间
+	::std::size_t to_chars(char* first, const unit_t* a, ::std::size_t n, unsigned base);
+
+	// 解析len位base进制数字所需limb数的上界. Note: 2 <= base <= 36
+	[[nodiscard]] ::std::size_t from_chars_length(::std::size_t len, unsigned base) noexcept;
+
+	// 把first[0..len)按base进制解析到r中, 返回有效limb数(可以为0). 数字可以是'0'-'9', 'a'-'z'或'A'-'Z'.
+	// base为2的幂时按位拼接, 代价为线性.
+	// Note: 调用方需保证每个字符都是合法数字, r至少要有from_chars_length(len, base)个limb的空间
+	::std::size_t from_chars(unit_t* r, const char* first, ::std::size_t len, unsigned base);
+
+}
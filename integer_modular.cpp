@@ -0,0 +1,359 @@
+﻿#include"integer_modular.h"
+#include"integer_kernel.h"
+#include<algorithm>
+#include<stdexcept>
+#include<vector>
+
+namespace C163q {
+
+	namespace {
+		// 滑动窗口的位数, 按指数的位数选择
+		[[nodiscard]] unsigned window_bits(const size_t bits) noexcept {
+			if (bits > 671) return 6;
+			if (bits > 239) return 5;
+			if (bits > 79) return 4;
+			if (bits > 23) return 3;
+			return 1;
+		}
+
+		// a模|m|的逆元, 不存在时抛出异常
+		[[nodiscard]] integer inverse_mod(const integer& a, const integer& m) {
+			auto [g, x, y] = xgcd(a, m);
+			if (!g.is_one()) throw ::std::domain_error("Base is not invertible modulo mod.");
+			return x;
+		}
+	}
+
+	modular_context::modular_context(const integer& modulus) : m(modulus.abs()), n(modulus.size()), montgomery(!modulus.is_zero() && (modulus[0] & 1)) {
+		if (m.is_zero() || m.is_one()) throw ::std::domain_error("Modulus must be greater than 1.");
+		const size_t bits = n * integer_container::unit_bit;
+		if (montgomery) {
+			const unit_t m0 = m[0];
+			unit_t inv = m0;					// m0 * m0 == 1 (mod 8), 即低3位正确
+			for (int i{}; i < 5; ++i) inv *= 2 - m0 * inv;	// 牛顿迭代, 每次有效位数翻倍
+			m_inv = 0 - inv;
+			if (n >= kernel::redc_dc_threshold) {
+				const integer r(integer(1) << bits);
+				integer x(::std::get<1>(xgcd(m, r)));	// m * x == 1 (mod R)
+				x %= r;
+				if (x.is_negative()) x += r;
+				load(m_inv_full, r - x);			// x != 0, -m^-1 mod R
+			}
+			load(unit, (integer(1) << bits) % m);
+			load(aux, (integer(1) << (2 * bits)) % m);
+		}
+		else {
+			const integer mu((integer(1) << (2 * bits)) / m);
+			aux.assign(mu.data(), mu.data() + mu.size());
+			load(unit, integer(1));
+		}
+	}
+
+	void modular_context::load(container_base& dst, const integer& x) const {
+		dst.assign(x.data(), x.data() + x.size());
+		dst.resize(n);
+	}
+
+	void modular_context::redc(unit_t* r, unit_t* t) const {
+		if (!m_inv_full.empty()) {
+			const kernel::scratch_buffer<unit_t> q(2 * n);
+			kernel::mul_n(q.data(), t, m_inv_full.data(), n);
+			const kernel::scratch_buffer<unit_t> qm(2 * n);
+			kernel::mul_n(qm.data(), q.data(), m.data(), n);
+			// t + q * m的低n个limb为0
+			const unit_t carry = kernel::add_n(t, t, qm.data(), 2 * n);
+			::std::copy(t + n, t + 2 * n, r);
+			if (carry || kernel::cmp(r, m.data(), n) >= 0) kernel::sub_n(r, r, m.data(), n);
+			return;
+		}
+		// 第i步消去t[i]; 本应加到t[i+n]上的进位先存进已经为0的t[i], 最后一起加到高半部分
+		for (size_t i{}; i < n; ++i) {
+			const unit_t u = t[i] * m_inv;
+			t[i] = kernel::addmul_1(t + i, m.data(), n, u);
+		}
+		const unit_t carry = kernel::add_n(r, t + n, t, n);
+		if (carry || kernel::cmp(r, m.data(), n) >= 0) kernel::sub_n(r, r, m.data(), n);
+	}
+
+	void modular_context::barrett(unit_t* r, const unit_t* t) const {
+		// q = floor(floor(t / B^(n-1)) * mu / B^(n+1))比真正的商最多小2, r = t - q * m在模B^(n+1)下计算
+		const size_t mu_n = aux.size();
+		const kernel::scratch_buffer<unit_t> q(n + 1 + mu_n);
+		kernel::mul(q.data(), aux.data(), mu_n, t + n - 1, n + 1);
+		const unit_t* const q3 = q.data() + n + 1;
+		// 只需要q * m的低n + 1个limb, 规模较小时逐行只算这一部分
+		const kernel::scratch_buffer<unit_t> qm(mu_n + n);
+		if (n < kernel::mul_karatsuba_threshold) {
+			for (size_t i{}; i <= n; ++i) {
+				const size_t len = ::std::min(n, n + 1 - i);
+				const unit_t carry = kernel::addmul_1(qm.data() + i, m.data(), len, q3[i]);
+				if (i + len <= n) qm[i + len] += carry;
+			}
+		}
+		else {
+			kernel::mul(qm.data(), q3, mu_n, m.data(), n);
+		}
+		const kernel::scratch_buffer<unit_t> x(n + 1);
+		kernel::sub_n(x.data(), t, qm.data(), n + 1);
+		while (x[n] || kernel::cmp(x.data(), m.data(), n) >= 0) {
+			x[n] -= kernel::sub_n(x.data(), x.data(), m.data(), n);
+		}
+		::std::copy(x.data(), x.data() + n, r);
+	}
+
+	void modular_context::mul_reduce(unit_t* r, const unit_t* a, const unit_t* b) const {
+		const kernel::scratch_buffer<unit_t> t(2 * n);
+		if (a == b) kernel::sqr(t.data(), a, n);
+		else kernel::mul_n(t.data(), a, b, n);
+		if (montgomery) redc(r, t.data());
+		else barrett(r, t.data());
+	}
+
+	void modular_context::add_reduce(unit_t* r, const unit_t* a, const unit_t* b) const noexcept {
+		const unit_t carry = kernel::add_n(r, a, b, n);
+		if (carry || kernel::cmp(r, m.data(), n) >= 0) kernel::sub_n(r, r, m.data(), n);
+	}
+
+	[[nodiscard]] modular_context::residue modular_context::make_residue() const {
+		residue ret;
+		ret.limbs.resize(n);
+		return ret;
+	}
+
+	[[nodiscard]] modular_context::residue modular_context::to_residue(const integer& x) const {
+		integer v(x % m);
+		if (v.is_negative()) v += m;
+		residue ret;
+		load(ret.limbs, v);
+		// x * R^2 * R^-1 = x * R
+		if (montgomery) mul_reduce(ret.limbs.data(), ret.limbs.data(), aux.data());
+		return ret;
+	}
+
+	[[nodiscard]] integer modular_context::to_integer(const residue& x) const {
+#if _DEBUG
+		assert(x.limbs.size() == n);
+#endif
+		integer ret{ integer::container_base(n) };
+		if (montgomery) {
+			const kernel::scratch_buffer<unit_t> t(2 * n);
+			::std::copy(x.limbs.begin(), x.limbs.end(), t.data());
+			redc(ret.data(), t.data());
+		}
+		else {
+			::std::copy(x.limbs.begin(), x.limbs.end(), ret.data());
+		}
+		ret.normalize();
+		return ret;
+	}
+
+	[[nodiscard]] modular_context::residue modular_context::zero() const {
+		return make_residue();
+	}
+
+	[[nodiscard]] modular_context::residue modular_context::one() const {
+		residue ret;
+		ret.limbs = unit;
+		return ret;
+	}
+
+	void modular_context::addmod(residue& r, const residue& a, const residue& b) const {
+		r.limbs.resize(n);
+		add_reduce(r.limbs.data(), a.limbs.data(), b.limbs.data());
+	}
+
+	void modular_context::submod(residue& r, const residue& a, const residue& b) const {
+		r.limbs.resize(n);
+		if (kernel::sub_n(r.limbs.data(), a.limbs.data(), b.limbs.data(), n)) {
+			kernel::add_n(r.limbs.data(), r.limbs.data(), m.data(), n);
+		}
+	}
+
+	void modular_context::mulmod(residue& r, const residue& a, const residue& b) const {
+		r.limbs.resize(n);
+		mul_reduce(r.limbs.data(), a.limbs.data(), b.limbs.data());
+	}
+
+	void modular_context::sqrmod(residue& r, const residue& a) const {
+		r.limbs.resize(n);
+		mul_reduce(r.limbs.data(), a.limbs.data(), a.limbs.data());
+	}
+
+	void modular_context::addmul(residue& r, const residue& a, const residue& b) const {
+		const kernel::scratch_buffer<unit_t> p(n);
+		mul_reduce(p.data(), a.limbs.data(), b.limbs.data());
+		r.limbs.resize(n);
+		add_reduce(r.limbs.data(), r.limbs.data(), p.data());
+	}
+
+	void modular_context::make_odd_powers(unit_t* table, const unit_t* base, const size_t count) const {
+		::std::copy(base, base + n, table);
+		if (count == 1) return;
+		const kernel::scratch_buffer<unit_t> sqr(n);
+		mul_reduce(sqr.data(), base, base);
+		for (size_t i{ 1 }; i < count; ++i) {
+			mul_reduce(table + i * n, table + (i - 1) * n, sqr.data());
+		}
+	}
+
+	void modular_context::select(unit_t* r, const unit_t* table, const size_t count, const size_t index) const noexcept {
+		::std::fill(r, r + n, unit_t{});
+		for (size_t i{}; i < count; ++i) {
+			const unit_t mask = unit_t{} - static_cast<unit_t>(i == index);
+			for (size_t j{}; j < n; ++j) r[j] |= table[i * n + j] & mask;
+		}
+	}
+
+	void modular_context::powmod_sliding(unit_t* r, const unit_t* base, const integer& exp) const {
+		const size_t bits = exp.bit_length();
+		const unsigned k = window_bits(bits);
+		const size_t count = size_t{ 1 } << (k - 1);
+		const kernel::scratch_buffer<unit_t> table(count * n);
+		make_odd_powers(table.data(), base, count);
+		const auto bit = exp.bit_cbegin();
+		bool started{};
+		// i为当前窗口的最高位. 窗口向下延伸至多k位, 并收缩到以1结尾, 值必为奇数
+		for (size_t i = bits; i--;) {
+			if (!bit[i]) {
+				mul_reduce(r, r, r);
+				continue;
+			}
+			size_t j = i + 1 > k ? i + 1 - k : 0;
+			while (!bit[j]) ++j;
+			const unit_t* const power = table.data() + (exp.extract_bits(j, static_cast<unsigned>(i - j + 1)) >> 1) * n;
+			if (started) {
+				for (size_t t{ j }; t <= i; ++t) mul_reduce(r, r, r);
+				mul_reduce(r, r, power);
+			}
+			else {
+				::std::copy(power, power + n, r);
+				started = true;
+			}
+			i = j;
+		}
+	}
+
+	void modular_context::powmod_fixed(unit_t* r, const unit_t* base, const integer& exp) const {
+		const size_t bits = ::std::max(exp.bit_length(), n * integer_container::unit_bit);
+		const unsigned k = ::std::max(window_bits(bits), 4U);
+		const size_t count = size_t{ 1 } << k;
+		// table[i] = base^i
+		const kernel::scratch_buffer<unit_t> table(count * n);
+		::std::copy(unit.begin(), unit.end(), table.data());
+		for (size_t i{ 1 }; i < count; ++i) {
+			mul_reduce(table.data() + i * n, table.data() + (i - 1) * n, base);
+		}
+		const kernel::scratch_buffer<unit_t> power(n);
+		::std::copy(unit.begin(), unit.end(), r);
+		for (size_t w = (bits + k - 1) / k; w--;) {
+			for (unsigned t{}; t < k; ++t) mul_reduce(r, r, r);
+			select(power.data(), table.data(), count, exp.extract_bits(w * k, k));
+			mul_reduce(r, r, power.data());
+		}
+	}
+
+	void modular_context::powmod(residue& r, const residue& base, const integer& exp, const bool constant_time) const {
+#if _DEBUG
+		assert(!exp.is_negative());
+#endif
+		const kernel::scratch_buffer<unit_t> acc(n);
+		if (constant_time) powmod_fixed(acc.data(), base.limbs.data(), exp);
+		else if (exp.is_zero()) ::std::copy(unit.begin(), unit.end(), acc.data());
+		else powmod_sliding(acc.data(), base.limbs.data(), exp);
+		r.limbs.assign(acc.data(), acc.data() + n);
+	}
+
+	void modular_context::multi_powmod(residue& r, ::std::span<const residue> bases, ::std::span<const integer> exps) const {
+#if _DEBUG
+		assert(bases.size() == exps.size());
+#endif
+		const size_t count = bases.size();
+		// 每个底数各自的窗口大小与奇数次幂表; pos[i]为下一个窗口的最低位(即在这一位上乘), value[i]为窗口的值
+		::std::vector<unsigned> k(count);
+		::std::vector<size_t> offset(count + 1);
+		::std::vector<size_t> pos(count);
+		::std::vector<unit_t> value(count);
+		::std::vector<bool> pending(count);
+		size_t bits{};
+		for (size_t i{}; i < count; ++i) {
+			const size_t len = exps[i].bit_length();
+			bits = ::std::max(bits, len);
+			k[i] = window_bits(len);
+			offset[i + 1] = offset[i] + (size_t{ 1 } << (k[i] - 1)) * n;
+		}
+		const kernel::scratch_buffer<unit_t> table(::std::max<size_t>(offset[count], 1));
+		// 找出第i个指数在top位(不含)以下的下一个窗口
+		const auto next_window = [&](const size_t i, size_t top) {
+			const auto bit = exps[i].bit_cbegin();
+			while (top && !bit[top - 1]) --top;
+			if (!top) {
+				pending[i] = false;
+				return;
+			}
+			const size_t high = top - 1;
+			size_t low = high + 1 > k[i] ? high + 1 - k[i] : 0;
+			while (!bit[low]) ++low;
+			pending[i] = true;
+			pos[i] = low;
+			value[i] = exps[i].extract_bits(low, static_cast<unsigned>(high - low + 1));
+		};
+		for (size_t i{}; i < count; ++i) {
+			if (exps[i].is_zero()) continue;
+			make_odd_powers(table.data() + offset[i], bases[i].limbs.data(), (offset[i + 1] - offset[i]) / n);
+			next_window(i, exps[i].bit_length());
+		}
+		const kernel::scratch_buffer<unit_t> acc(n);
+		::std::copy(unit.begin(), unit.end(), acc.data());
+		bool started{};
+		for (size_t p = bits; p--;) {
+			if (started) mul_reduce(acc.data(), acc.data(), acc.data());
+			for (size_t i{}; i < count; ++i) {
+				if (!pending[i] || pos[i] != p) continue;
+				const unit_t* const power = table.data() + offset[i] + (value[i] >> 1) * n;
+				if (started) {
+					mul_reduce(acc.data(), acc.data(), power);
+				}
+				else {
+					::std::copy(power, power + n, acc.data());
+					started = true;
+				}
+				next_window(i, p);
+			}
+		}
+		r.limbs.assign(acc.data(), acc.data() + n);
+	}
+
+	[[nodiscard]] integer powmod(const integer& base, const integer& exp, const integer& mod, const bool constant_time) {
+		if (mod.is_zero()) throw ::std::domain_error("Moded by zero.");
+		if (mod.is_one_abs()) return {};
+		const modular_context ctx(mod);
+		modular_context::residue r;
+		if (exp.is_negative()) ctx.powmod(r, ctx.to_residue(inverse_mod(base, mod)), exp.abs(), constant_time);
+		else ctx.powmod(r, ctx.to_residue(base), exp, constant_time);
+		return ctx.to_integer(r);
+	}
+
+	[[nodiscard]] integer multi_powmod(::std::span<const integer> bases, ::std::span<const integer> exps, const integer& mod) {
+#if _DEBUG
+		assert(bases.size() == exps.size());
+#endif
+		if (mod.is_zero()) throw ::std::domain_error("Moded by zero.");
+		if (mod.is_one_abs()) return {};
+		const modular_context ctx(mod);
+		// 负指数改为逆元的正指数, 只有这时才复制指数
+		const bool any_negative = ::std::any_of(exps.begin(), exps.end(), [](const integer& e) { return e.is_negative(); });
+		::std::vector<modular_context::residue> b;
+		::std::vector<integer> e;
+		b.reserve(bases.size());
+		if (any_negative) e.reserve(exps.size());
+		for (size_t i{}; i < bases.size(); ++i) {
+			b.push_back(ctx.to_residue(exps[i].is_negative() ? inverse_mod(bases[i], mod) : bases[i]));
+			if (any_negative) e.push_back(exps[i].abs());
+		}
+		modular_context::residue r;
+		if (any_negative) ctx.multi_powmod(r, b, e);
+		else ctx.multi_powmod(r, b, exps);
+		return ctx.to_integer(r);
+	}
+
+}
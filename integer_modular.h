@@ -0,0 +1,142 @@
+﻿#pragma once
+#include<cstddef>
+#include<span>
+#include"integer.h"
+
+
+namespace C163q {
+
+	/// @brief 固定模数m下的模运算. 构造时预先算好约化所需的常数, 之后的乘法只用乘法与加减法完成约化, 不做一般的除法:
+	/// m为奇数时用Montgomery约化(R = B^n, B = 2^unit_bit, n为m的limb数), 否则用Barrett约化.
+	/// 参与运算的是`residue`, 总是恰好占n个limb, 运算结果写回已有的存储; 用`to_residue`/`to_integer`与`integer`互相转换.
+	/// eg. `modular_context ctx(m); auto x = ctx.to_residue(a); ctx.mulmod(x, x, ctx.to_residue(b)); integer r = ctx.to_integer(x);`
+	class modular_context {
+	public:
+		using unit_t = integer_container::unit_t;
+		using container_base = integer_container::container_base_t;
+
+		/// @brief 模m的剩余, 保存n个limb(Montgomery约化时为Montgomery形式: x * R mod m).
+		/// 只能与创建它的`modular_context`(或模数相同的context)一起使用
+		class residue {
+			friend modular_context;
+		private:
+			container_base limbs;
+
+		public:
+			residue() = default;
+
+			[[nodiscard]] bool is_zero() const noexcept {
+				for (const unit_t limb : limbs) {
+					if (limb) return false;
+				}
+				return true;
+			}
+
+			[[nodiscard]] bool operator==(const residue& other) const noexcept {
+				return limbs == other.limbs;
+			}
+
+			[[nodiscard]] bool operator!=(const residue& other) const noexcept {
+				return !operator==(other);
+			}
+		};
+
+	private:
+		integer m;						// 模数(非负)
+		container_base aux;				// Montgomery: R^2 mod m; Barrett: floor(B^(2n) / m)
+		container_base unit;			// 1的表示. Montgomery: R mod m
+		container_base m_inv_full;		// Montgomery且n不低于`kernel::redc_dc_threshold`时: -m^-1 mod R
+		::std::size_t n;
+		unit_t m_inv{};					// Montgomery: -m^-1 mod B
+		bool montgomery;
+
+		// 把x(0 <= x < B^n)写成n个limb
+		void load(container_base& dst, const integer& x) const;
+
+		// r[0..n) = t[0..2n) * R^-1 mod m, t被破坏. Note: t < m * R.
+		// 逐limb约化, 代价为n^2; n较大时改为两次整块乘法: q = t * m' mod R, r = (t + q * m) / R
+		void redc(unit_t* r, unit_t* t) const;
+
+		// r[0..n) = t[0..2n) mod m. Note: t < B^(2n)
+		void barrett(unit_t* r, const unit_t* t) const;
+
+		// r[0..n) = a[0..n) * b[0..n)约化后的结果(Montgomery约化时带R^-1). r可以与a或b相同
+		void mul_reduce(unit_t* r, const unit_t* a, const unit_t* b) const;
+
+		// r[0..n) = (a + b) mod m. r可以与a或b相同
+		void add_reduce(unit_t* r, const unit_t* a, const unit_t* b) const noexcept;
+
+		[[nodiscard]] residue make_residue() const;
+
+		// table[i] = base^(2i + 1), i < count
+		void make_odd_powers(unit_t* table, const unit_t* base, const ::std::size_t count) const;
+
+		// r[0..n) = table[index], 按相同的顺序读取整张表, 访存模式与index无关
+		void select(unit_t* r, const unit_t* table, const ::std::size_t count, const ::std::size_t index) const noexcept;
+
+		// 滑动窗口: 跳过0位, 只在以1结尾的窗口上做乘法
+		void powmod_sliding(unit_t* r, const unit_t* base, const integer& exp) const;
+
+		// 固定窗口: 每个窗口都做同样次数的平方与一次乘法(0窗口乘1), 查表用`select`
+		void powmod_fixed(unit_t* r, const unit_t* base, const integer& exp) const;
+
+	public:
+		// Note: |modulus| > 1, 只使用其绝对值
+		explicit modular_context(const integer& modulus);
+
+		[[nodiscard]] const integer& modulus() const noexcept {
+			return m;
+		}
+
+		// m的limb数, 即每个`residue`的长度
+		[[nodiscard]] ::std::size_t size() const noexcept {
+			return n;
+		}
+
+		[[nodiscard]] bool is_montgomery() const noexcept {
+			return montgomery;
+		}
+
+		// x mod m(结果非负). 这里会做一次除法, 应在进入循环之前转换
+		[[nodiscard]] residue to_residue(const integer& x) const;
+
+		[[nodiscard]] integer to_integer(const residue& x) const;
+
+		[[nodiscard]] residue zero() const;
+
+		[[nodiscard]] residue one() const;
+
+		// 以下运算的r都可以与a或b相同
+
+		// r = (a + b) mod m
+		void addmod(residue& r, const residue& a, const residue& b) const;
+
+		// r = (a - b) mod m
+		void submod(residue& r, const residue& a, const residue& b) const;
+
+		// r = a * b mod m
+		void mulmod(residue& r, const residue& a, const residue& b) const;
+
+		// r = a^2 mod m, 利用平方的对称性
+		void sqrmod(residue& r, const residue& a) const;
+
+		// r = (r + a * b) mod m
+		void addmul(residue& r, const residue& a, const residue& b) const;
+
+		// r = base^exp mod m, 按指数的位数选择窗口大小(最大6位)的滑动窗口法.
+		// constant_time为true时改用固定窗口, 并按exp与m中较长者的位数扫描: 平方/乘法的次数与查表的访存模式
+		// 都不依赖于exp的值, 适用于秘密指数. Note: exp >= 0, 约化与乘法内核本身不保证常数时间
+		void powmod(residue& r, const residue& base, const integer& exp, const bool constant_time = false) const;
+
+		// r = Π bases[i]^exps[i] mod m, 各底数的滑动窗口交错进行, 共用同一串平方. Note: exps[i] >= 0, 两者长度相同
+		void multi_powmod(residue& r, ::std::span<const residue> bases, ::std::span<const integer> exps) const;
+	};
+
+	// base^exp mod |mod|, 奇数模数用Montgomery约化, 否则用Barrett约化(见`modular_context`). 结果在[0, |mod|)中.
+	// exp < 0时使用base的逆元, 不存在时抛出`::std::domain_error`
+	[[nodiscard]] integer powmod(const integer& base, const integer& exp, const integer& mod, const bool constant_time = false);
+
+	// Π bases[i]^exps[i] mod |mod|, 所有底数共用平方. 负指数的处理同`powmod`. Note: 两者长度相同
+	[[nodiscard]] integer multi_powmod(::std::span<const integer> bases, ::std::span<const integer> exps, const integer& mod);
+
+}
@@ -0,0 +1,247 @@
+﻿#include"integer_kernel.h"
+#include<algorithm>
+#include<cstdint>
+
+// 三素数数论变换(NTT)乘法: 把limb拆成d位的数字作为多项式系数, 分别在三个素数下做卷积,
+// 再用中国剩余定理(Garner算法)还原每个系数并进位.
+
+namespace C163q::kernel {
+
+	namespace {
+		using ntt_word = ::std::uint32_t;
+
+		/// @brief 模素数P的运算(Montgomery形式, R = 2^32)及长度为2的幂的NTT, G为P的原根
+		template<ntt_word P, ntt_word G>
+		class ntt_field {
+		public:
+			constexpr static ntt_word mod = P;
+
+		private:
+			// -P^-1 mod 2^32
+			[[nodiscard]] constexpr static ntt_word neg_inverse() noexcept {
+				ntt_word inv = P;
+				for (int i{}; i < 5; ++i) inv *= 2 - P * inv;	// 牛顿迭代, 每次有效位数翻倍
+				return 0 - inv;
+			}
+
+			constexpr static ntt_word p_neg_inv = neg_inverse();
+			constexpr static ntt_word r2 = static_cast<ntt_word>((~::std::uint64_t{} % P + 1) % P);	// R^2 mod P
+
+		public:
+			// 返回t * R^-1 mod P. Note: t < P * 2^32
+			[[nodiscard]] static ntt_word reduce(const ::std::uint64_t t) noexcept {
+				const ntt_word m = static_cast<ntt_word>(t) * p_neg_inv;
+				const ntt_word ret = static_cast<ntt_word>((t + static_cast<::std::uint64_t>(m) * P) >> 32);
+				return ret >= P ? ret - P : ret;
+			}
+
+			[[nodiscard]] static ntt_word to_montgomery(const ntt_word a) noexcept {
+				return reduce(static_cast<::std::uint64_t>(a % P) * r2);
+			}
+
+			// 编译期常量的Montgomery形式: a * R mod P
+			[[nodiscard]] constexpr static ntt_word montgomery_constant(const ntt_word a) noexcept {
+				return static_cast<ntt_word>((static_cast<::std::uint64_t>(a % P) << 32) % P);
+			}
+
+			[[nodiscard]] static ntt_word add(const ntt_word a, const ntt_word b) noexcept {
+				const ntt_word s = a + b;		// P < 2^30, 不会溢出
+				return s >= P ? s - P : s;
+			}
+
+			[[nodiscard]] static ntt_word sub(const ntt_word a, const ntt_word b) noexcept {
+				return a >= b ? a - b : a + P - b;
+			}
+
+			// Montgomery乘法: a * b * R^-1 mod P
+			[[nodiscard]] static ntt_word mul(const ntt_word a, const ntt_word b) noexcept {
+				return reduce(static_cast<::std::uint64_t>(a) * b);
+			}
+
+			[[nodiscard]] constexpr static ntt_word pow(ntt_word a, ::std::uint64_t e) noexcept {
+				::std::uint64_t ret{ 1 };
+				::std::uint64_t base{ a % P };
+				while (e) {
+					if (e & 1) ret = ret * base % P;
+					base = base * base % P;
+					e >>= 1;
+				}
+				return static_cast<ntt_word>(ret);
+			}
+
+			// roots[len + j] = w^j (Montgomery形式), 其中w是2len次单位根, len = 1, 2, 4, ..., n / 2.
+			// Note: roots至少有max(n, 2)个元素
+			static void make_roots(ntt_word* roots, const ::std::size_t n, const bool inverse) {
+				::std::fill(roots, roots + ::std::max<::std::size_t>(n, 2), to_montgomery(1));
+				for (::std::size_t len{ 1 }; len < n; len <<= 1) {
+					ntt_word w = pow(G, (P - 1) / (2 * len));
+					if (inverse) w = pow(w, P - 2);
+					w = to_montgomery(w);
+					for (::std::size_t j{ 1 }; j < len; ++j) {
+						roots[len + j] = mul(roots[len + j - 1], w);
+					}
+				}
+			}
+
+			// 自然顺序输入, 位反转顺序输出(Gentleman-Sande)
+			static void forward(ntt_word* f, const ::std::size_t n, const ntt_word* roots) noexcept {
+				for (::std::size_t len{ n >> 1 }; len; len >>= 1) {
+					for (::std::size_t i{}; i < n; i += 2 * len) {
+						for (::std::size_t j{}; j < len; ++j) {
+							const ntt_word u = f[i + j];
+							const ntt_word v = f[i + j + len];
+							f[i + j] = add(u, v);
+							f[i + j + len] = mul(sub(u, v), roots[len + j]);
+						}
+					}
+				}
+			}
+
+			// 位反转顺序输入, 自然顺序输出(Cooley-Tukey), 未除以n
+			static void inverse(ntt_word* f, const ::std::size_t n, const ntt_word* iroots) noexcept {
+				for (::std::size_t len{ 1 }; len < n; len <<= 1) {
+					for (::std::size_t i{}; i < n; i += 2 * len) {
+						for (::std::size_t j{}; j < len; ++j) {
+							const ntt_word u = f[i + j];
+							const ntt_word v = mul(f[i + j + len], iroots[len + j]);
+							f[i + j] = add(u, v);
+							f[i + j + len] = sub(u, v);
+						}
+					}
+				}
+			}
+		};
+
+		using field1 = ntt_field<469762049U, 3U>;		// 7 * 2^26 + 1
+		using field2 = ntt_field<167772161U, 3U>;		// 5 * 2^25 + 1
+		using field3 = ntt_field<754974721U, 11U>;		// 45 * 2^24 + 1
+
+		constexpr ::std::size_t ntt_max_length{ ::std::size_t{ 1 } << 24 };	// 受field3限制
+		// 系数为32位数字时, 卷积的每一项最多累加这么多个乘积而不超过p1 * p2 * p3
+		constexpr ::std::size_t ntt_max_terms_32{ 3'000'000 };
+
+		/// @brief 把limb数组按d位拆分后的数字序列
+		struct digit_view {
+			const unit_t* data;
+			::std::size_t limbs;
+			unsigned d;
+
+			[[nodiscard]] ::std::size_t length() const noexcept {
+				return limbs * (unit_bit / d);
+			}
+
+			[[nodiscard]] ntt_word operator[](const ::std::size_t i) const noexcept {
+				const unsigned per = unit_bit / d;
+				const ::std::uint64_t mask = (::std::uint64_t{ 1 } << d) - 1;
+				return static_cast<ntt_word>((data[i / per] >> ((i % per) * d)) & mask);
+			}
+		};
+
+		// 在模F::mod下计算a与b的循环卷积, 结果(自然顺序, 普通形式)存于out[0..n). Note: out已清零
+		template<class F>
+		void convolve(ntt_word* out, const digit_view& a, const digit_view& b, const ::std::size_t n) {
+			const scratch_buffer<ntt_word> roots(::std::max<::std::size_t>(n, 2));
+			F::make_roots(roots.data(), n, false);
+			for (::std::size_t i{}; i < a.length(); ++i) out[i] = F::to_montgomery(a[i]);
+			F::forward(out, n, roots.data());
+			if (a.data != b.data || a.limbs != b.limbs) {
+				const scratch_buffer<ntt_word> fb(n);
+				for (::std::size_t i{}; i < b.length(); ++i) fb[i] = F::to_montgomery(b[i]);
+				F::forward(fb.data(), n, roots.data());
+				for (::std::size_t i{}; i < n; ++i) out[i] = F::mul(out[i], fb[i]);
+			}
+			else {
+				for (::std::size_t i{}; i < n; ++i) out[i] = F::mul(out[i], out[i]);
+			}
+			F::make_roots(roots.data(), n, true);
+			F::inverse(out, n, roots.data());
+			// 以普通形式的n^-1相乘, 同时完成除以n与离开Montgomery形式
+			const ntt_word inv_n = F::pow(static_cast<ntt_word>(n % F::mod), F::mod - 2);
+			for (::std::size_t i{}; i < n; ++i) out[i] = F::mul(out[i], inv_n);
+		}
+
+		/// @brief 128位无符号数, 用于合并系数与进位
+		struct wide_t {
+			::std::uint64_t low;
+			::std::uint64_t high;
+
+			void add(const wide_t& other) noexcept {
+				low += other.low;
+				high += other.high + (low < other.low);
+			}
+
+			// Note: 0 < bit < 64
+			void shift_right(const unsigned bit) noexcept {
+				low = (low >> bit) | (high << (64 - bit));
+				high >>= bit;
+			}
+		};
+
+		// 已知c mod p1, p2, p3, 求c (c < p1 * p2 * p3)
+		[[nodiscard]] wide_t crt(const ntt_word r1, const ntt_word r2, const ntt_word r3) noexcept {
+			constexpr ::std::uint64_t p1 = field1::mod;
+			constexpr ::std::uint64_t p2 = field2::mod;
+			constexpr ::std::uint64_t p1p2 = p1 * p2;		// < 2^57
+			// 逆元取Montgomery形式, 与普通形式的数相乘后得到普通形式的结果
+			constexpr ntt_word inv_p1_p2 = field2::montgomery_constant(field2::pow(field1::mod % field2::mod, field2::mod - 2));
+			constexpr ntt_word inv_p1_p3 = field3::montgomery_constant(field3::pow(field1::mod % field3::mod, field3::mod - 2));
+			constexpr ntt_word inv_p2_p3 = field3::montgomery_constant(field3::pow(field2::mod % field3::mod, field3::mod - 2));
+			// c = x1 + x2 * p1 + x3 * p1 * p2
+			const ntt_word x1 = r1;
+			const ntt_word x2 = field2::mul(field2::sub(r2, x1 % field2::mod), inv_p1_p2);
+			const ntt_word x3 = field3::mul(field3::sub(field3::mul(field3::sub(r3, x1 % field3::mod), inv_p1_p3), x2 % field3::mod), inv_p2_p3);
+			const ::std::uint64_t low_part = x1 + x2 * p1;						// < 2^60
+			const ::std::uint64_t m_low = (p1p2 & 0xFFFF'FFFFU) * x3;			// < 2^62
+			const ::std::uint64_t m_high = (p1p2 >> 32) * x3;					// < 2^55
+			wide_t ret{ m_low, 0 };
+			ret.add(wide_t{ m_high << 32, m_high >> 32 });
+			ret.add(wide_t{ low_part, 0 });
+			return ret;
+		}
+
+		// 选择系数的位数, 返回0表示超出NTT能处理的范围
+		[[nodiscard]] unsigned choose_digit_bits(const ::std::size_t an, const ::std::size_t bn, ::std::size_t& length) noexcept {
+			for (unsigned d : { 32U, 16U }) {
+				if (d > unit_bit) continue;
+				const ::std::size_t per = unit_bit / d;
+				const ::std::size_t need = (an + bn) * per - 1;
+				if (need > ntt_max_length) return 0;
+				if (d == 32 && ::std::min(an, bn) * per > ntt_max_terms_32) continue;
+				length = 1;
+				while (length < need) length <<= 1;
+				return d;
+			}
+			return 0;
+		}
+	}
+
+	bool mul_ntt(unit_t* r, const unit_t* a, ::std::size_t an, const unit_t* b, ::std::size_t bn) {
+		::std::size_t n{};
+		const unsigned d = choose_digit_bits(an, bn, n);
+		if (!d) return false;
+		const digit_view da{ a, an, d };
+		const digit_view db{ b, bn, d };
+		const scratch_buffer<ntt_word> c1(n), c2(n), c3(n);
+		convolve<field1>(c1.data(), da, db, n);
+		convolve<field2>(c2.data(), da, db, n);
+		convolve<field3>(c3.data(), da, db, n);
+
+		// 逐个系数还原并进位, 每d位拼入一个limb
+		const unsigned per = unit_bit / d;
+		const ::std::size_t terms = da.length() + db.length() - 1;
+		const ::std::uint64_t mask = (::std::uint64_t{ 1 } << d) - 1;
+		wide_t acc{};
+		::std::size_t k{};
+		for (::std::size_t i{}; i < an + bn; ++i) {
+			unit_t limb{};
+			for (unsigned j{}; j < per; ++j, ++k) {
+				if (k < terms) acc.add(crt(c1[k], c2[k], c3[k]));
+				limb |= static_cast<unit_t>(acc.low & mask) << (j * d);
+				acc.shift_right(d);
+			}
+			r[i] = limb;
+		}
+		return true;
+	}
+
+}
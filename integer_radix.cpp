@@ -0,0 +1,282 @@
+﻿#include"integer_kernel.h"
+#include<algorithm>
+#include<array>
+#include<bit>
+#include<cmath>
+#include<cstring>
+
+// 进制转换: 小规模时逐块除以(解析时乘以)base^k(k为一个limb能容纳的最多位数), 大规模时按预先求出的
+// base^(k*2^i)分治, 使转换的代价与除法(解析时为乘法)同阶.
+// base为2的幂时直接按位切分limb, 代价为线性.
+
+namespace C163q::kernel {
+
+	namespace {
+		/// @brief 一个limb能容纳的base进制数字块
+		struct radix_info {
+			unsigned base;
+			unsigned digits;		// 每块的位数k
+			unit_t chunk;			// base^k
+
+			explicit radix_info(const unsigned base) noexcept : base(base), digits(), chunk(1) {
+				while (chunk <= integer_container::unit_max / base) {
+					chunk *= base;
+					++digits;
+				}
+			}
+		};
+
+		[[nodiscard]] char digit_char(const unsigned v) noexcept {
+			return static_cast<char>(v < 10 ? '0' + v : 'a' + (v - 10));
+		}
+
+		[[nodiscard]] ::std::size_t significant(const unit_t* a, ::std::size_t n) noexcept {
+			while (n && !a[n - 1]) --n;
+			return n;
+		}
+
+		/// @brief 只读的limb数组
+		class limb_view {
+		private:
+			const unit_t* ptr{};
+			::std::size_t n{};
+
+		public:
+			limb_view() noexcept = default;
+			limb_view(const unit_t* ptr, const ::std::size_t n) noexcept : ptr(ptr), n(n) {}
+
+			[[nodiscard]] const unit_t* data() const noexcept {
+				return ptr;
+			}
+
+			[[nodiscard]] ::std::size_t size() const noexcept {
+				return n;
+			}
+		};
+
+		/// @brief powers[i] = chunk^(2^i), 供一次转换中反复使用. 所有幂连续存放在一块临时缓冲区中
+		class radix_powers {
+		private:
+			// 每一级的位数至多是上一级的两倍, 所以已保存的幂与正在求的平方都不超过limit + 1 limb
+			scratch_buffer<unit_t> storage;
+			::std::array<limb_view, 64> powers;
+			::std::size_t levels;
+
+		public:
+			// 求出位数不超过(limit + 1) / 2 limb的所有幂
+			radix_powers(const radix_info& info, const ::std::size_t limit) : storage(2 * (limit + 2)), powers(), levels(1) {
+				unit_t* next = storage.data();
+				*next = info.chunk;
+				powers[0] = { next++, 1 };
+				while (2 * powers[levels - 1].size() <= limit + 1) {
+					const limb_view last = powers[levels - 1];
+					sqr(next, last.data(), last.size());
+					const ::std::size_t n = significant(next, 2 * last.size());
+					if (2 * n > limit + 1) break;
+					powers[levels++] = { next, n };
+					next += n;
+				}
+			}
+
+			// 位数不超过(n + 1) / 2 limb的最大的幂
+			[[nodiscard]] ::std::size_t level_for(const ::std::size_t n) const noexcept {
+				::std::size_t i{};
+				while (i + 1 < levels && 2 * powers[i + 1].size() <= n + 1) ++i;
+				return i;
+			}
+
+			[[nodiscard]] const limb_view& operator[](const ::std::size_t i) const noexcept {
+				return powers[i];
+			}
+
+			[[nodiscard]] ::std::size_t size() const noexcept {
+				return levels;
+			}
+		};
+
+		// 把x[0..n)写成恰好width位(高位补'0'), x会被修改. Note: x的位数不超过width
+		void to_chars_basecase(char* out, ::std::size_t width, unit_t* x, ::std::size_t n, const radix_info& info) noexcept {
+			char* p = out + width;
+			while (n && p != out) {
+				unit_t rem = divrem_1(x, x, n, info.chunk);
+				if (!x[n - 1]) --n;
+				for (unsigned i{}; i < info.digits && p != out; ++i) {
+					*--p = digit_char(static_cast<unsigned>(rem % info.base));
+					rem /= info.base;
+				}
+			}
+			::std::fill(out, p, '0');
+		}
+
+		void to_chars_dc(char* out, const ::std::size_t width, const unit_t* x, ::std::size_t n, const radix_powers& powers, const radix_info& info) {
+			n = significant(x, n);
+			if (n < ::std::max<::std::size_t>(radix_dc_threshold, 3)) {
+				const scratch_buffer<unit_t> tmp(n);
+				::std::copy(x, x + n, tmp.data());
+				to_chars_basecase(out, width, tmp.data(), n, info);
+				return;
+			}
+			// x = q * base^(k*2^i) + r, 低半部分恰好有k*2^i位
+			const ::std::size_t level = powers.level_for(n);
+			const limb_view& p = powers[level];
+			const ::std::size_t low_width = static_cast<::std::size_t>(info.digits) << level;
+			const ::std::size_t qn = n - p.size() + 1;
+			const scratch_buffer<unit_t> q(qn);
+			const scratch_buffer<unit_t> r(p.size());
+			divrem(q.data(), r.data(), x, n, p.data(), p.size());
+			to_chars_dc(out, width - low_width, q.data(), qn, powers, info);
+			to_chars_dc(out + width - low_width, low_width, r.data(), p.size(), powers, info);
+		}
+
+		// base = 2^bit时每个数字恰好对应bit位, 直接切分limb即可
+		[[nodiscard]] unsigned power_of_two_bit(const unsigned base) noexcept {
+			return ::std::has_single_bit(base) ? static_cast<unsigned>(::std::countr_zero(base)) : 0;
+		}
+
+		// 取a[0..n)从第pos位开始的bit位(超出n的部分视为0)
+		[[nodiscard]] unsigned extract_bits(const unit_t* a, const ::std::size_t n, const ::std::size_t pos, const unsigned bit) noexcept {
+			const ::std::size_t index = pos / unit_bit;
+			const unsigned offset = static_cast<unsigned>(pos % unit_bit);
+			unit_t v = a[index] >> offset;
+			if (offset + bit > unit_bit && index + 1 < n) v |= a[index + 1] << (unit_bit - offset);
+			return static_cast<unsigned>(v & ((unit_t{ 1 } << bit) - 1));
+		}
+
+		::std::size_t to_chars_power_of_two(char* first, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+			const ::std::size_t bits = n * unit_bit - ::std::countl_zero(a[n - 1]);
+			const ::std::size_t len = (bits + bit - 1) / bit;
+			for (::std::size_t i{}; i < len; ++i) {
+				first[len - 1 - i] = digit_char(extract_bits(a, n, i * bit, bit));
+			}
+			return len;
+		}
+
+		// Note: r[0..)已清零
+		::std::size_t from_chars_power_of_two(unit_t* r, const char* first, const ::std::size_t len, const unsigned bit) noexcept {
+			::std::size_t pos{};
+			for (const char* p = first + len; p != first; pos += bit) {
+				const unit_t v = digit_value(*--p);
+				const ::std::size_t index = pos / unit_bit;
+				const unsigned offset = static_cast<unsigned>(pos % unit_bit);
+				r[index] |= v << offset;
+				if (offset + bit > unit_bit) r[index + 1] |= v >> (unit_bit - offset);
+			}
+			return significant(r, (pos + unit_bit - 1) / unit_bit);
+		}
+
+		// 逐块累加: r = r * base^k + chunk_value, 返回r的有效limb数. Note: r[0..)已清零
+		::std::size_t from_chars_basecase(unit_t* r, const char* first, const ::std::size_t len, const radix_info& info) noexcept {
+			::std::size_t n{};
+			::std::size_t i{};
+			// 首块取len % k位, 其余每块恰好k位
+			::std::size_t group = len % info.digits ? len % info.digits : info.digits;
+			while (i < len) {
+				unit_t value{};
+				unit_t scale{ 1 };
+				for (const ::std::size_t end = i + group; i < end; ++i) {
+					value = value * info.base + digit_value(first[i]);
+					scale *= info.base;
+				}
+				if (!n) {
+					r[0] = value;
+					n = value ? 1 : 0;
+				}
+				else {
+					unit_t carry = mul_1(r, r, n, scale);
+					carry += add_1(r, r, n, value);		// r * scale + value < (r + 1) * scale, 不会溢出
+					if (carry) r[n++] = carry;
+				}
+				group = info.digits;
+			}
+			return n;
+		}
+
+		// 把first[0..len)拆成高位与恰好k*2^i位的低位, r = high * base^(k*2^i) + low, 返回r的有效limb数
+		::std::size_t from_chars_dc(unit_t* r, const char* first, const ::std::size_t len, const radix_powers& powers, const radix_info& info) {
+			if (from_chars_length(len, info.base) < ::std::max<::std::size_t>(radix_dc_threshold, 3)) {
+				return from_chars_basecase(r, first, len, info);
+			}
+			::std::size_t level = powers.size() - 1;
+			while (level && (static_cast<::std::size_t>(info.digits) << level) >= len) --level;
+			const ::std::size_t low_len = static_cast<::std::size_t>(info.digits) << level;
+			const limb_view& p = powers[level];
+
+			const scratch_buffer<unit_t> high(from_chars_length(len - low_len, info.base));
+			const ::std::size_t hn = from_chars_dc(high.data(), first, len - low_len, powers, info);
+			const scratch_buffer<unit_t> low(from_chars_length(low_len, info.base));
+			const ::std::size_t ln = from_chars_dc(low.data(), first + len - low_len, low_len, powers, info);
+			if (!hn) {
+				::std::copy(low.data(), low.data() + ln, r);
+				return ln;
+			}
+			if (hn >= p.size()) mul(r, high.data(), hn, p.data(), p.size());
+			else mul(r, p.data(), p.size(), high.data(), hn);
+			const ::std::size_t n = hn + p.size();
+			if (ln) add(r, r, n, low.data(), ln);		// low < p, 不会产生进位
+			return significant(r, n);
+		}
+	}
+
+	unsigned digit_value(const char c) noexcept {
+		if (c >= '0' && c <= '9') return static_cast<unsigned>(c - '0');
+		if (c >= 'a' && c <= 'z') return static_cast<unsigned>(c - 'a' + 10);
+		if (c >= 'A' && c <= 'Z') return static_cast<unsigned>(c - 'A' + 10);
+		return 36;
+	}
+
+	::std::size_t to_chars_length(const unit_t* a, ::std::size_t n, unsigned base) noexcept {
+		n = significant(a, n);
+		if (!n) return 1;
+		const ::std::size_t bits = n * unit_bit - ::std::countl_zero(a[n - 1]);
+		if (const unsigned bit = power_of_two_bit(base)) return (bits + bit - 1) / bit;
+		// 多出的一位用于吸收浮点误差
+		return static_cast<::std::size_t>(static_cast<double>(bits) / ::std::log2(static_cast<double>(base))) + 2;
+	}
+
+	::std::size_t to_chars(char* first, const unit_t* a, ::std::size_t n, unsigned base) {
+		n = significant(a, n);
+		if (!n) {
+			*first = '0';
+			return 1;
+		}
+		if (const unsigned bit = power_of_two_bit(base)) {
+			return to_chars_power_of_two(first, a, n, bit);
+		}
+		const radix_info info(base);
+		const ::std::size_t width = to_chars_length(a, n, base);
+		if (n < ::std::max<::std::size_t>(radix_dc_threshold, 3)) {
+			const scratch_buffer<unit_t> tmp(n);
+			::std::copy(a, a + n, tmp.data());
+			to_chars_basecase(first, width, tmp.data(), n, info);
+		}
+		else {
+			const radix_powers powers(info, n);
+			to_chars_dc(first, width, a, n, powers, info);
+		}
+		// 去掉按上界补出的前导'0'
+		const char* const lead = ::std::find_if(first, first + width, [](const char c) { return c != '0'; });
+		const ::std::size_t len = static_cast<::std::size_t>(first + width - lead);
+		::std::memmove(first, lead, len);
+		return len;
+	}
+
+	::std::size_t from_chars_length(const ::std::size_t len, const unsigned base) noexcept {
+		const double bits = static_cast<double>(len) * ::std::log2(static_cast<double>(base));
+		return static_cast<::std::size_t>(bits / unit_bit) + 2;
+	}
+
+	::std::size_t from_chars(unit_t* r, const char* first, const ::std::size_t len, const unsigned base) {
+		const radix_info info(base);
+		const ::std::size_t rn = from_chars_length(len, base);
+		::std::fill(r, r + rn, unit_t{});
+		if (const unsigned bit = power_of_two_bit(base)) {
+			return from_chars_power_of_two(r, first, len, bit);
+		}
+		if (rn < ::std::max<::std::size_t>(radix_dc_threshold, 3)) {
+			return from_chars_basecase(r, first, len, info);
+		}
+		const radix_powers powers(info, rn);
+		return from_chars_dc(r, first, len, powers, info);
+	}
+
+}
@@ -0,0 +1,94 @@
+﻿#include"integer_kernel.h"
+#include<array>
+#include<bit>
+#include<new>
+#include<vector>
+
+// 线程局部的临时缓冲池: 块按2的幂分级, 每级一个空闲链表. 借出与归还大多是嵌套的(递归),
+// 所以同规模的运算重复执行时总能命中缓存.
+
+namespace C163q::kernel {
+
+	namespace {
+		constexpr unsigned min_level = 6;		// 最小的块为64字节
+		constexpr unsigned level_count = 64;
+
+		class scratch_pool {
+		private:
+			::std::array<::std::vector<void*>, level_count> free_blocks;
+			::std::size_t cached_bytes{};
+
+		public:
+			scratch_statistics stats{};
+
+			scratch_pool() = default;
+			scratch_pool(const scratch_pool&) = delete;
+			scratch_pool& operator=(const scratch_pool&) = delete;
+
+			~scratch_pool() {
+				release();
+			}
+
+			[[nodiscard]] void* acquire(const ::std::size_t bytes, unsigned& level) {
+				level = ::std::max(min_level, static_cast<unsigned>(::std::bit_width(bytes > 1 ? bytes - 1 : 0)));
+				::std::vector<void*>& blocks = free_blocks[level];
+				if (!blocks.empty()) {
+					++stats.hits;
+					void* const block = blocks.back();
+					blocks.pop_back();
+					cached_bytes -= ::std::size_t{ 1 } << level;
+					return block;
+				}
+				++stats.misses;
+				return ::operator new(::std::size_t{ 1 } << level);
+			}
+
+			void release(void* const block, const unsigned level) noexcept {
+				const ::std::size_t size = ::std::size_t{ 1 } << level;
+				if (cached_bytes + size <= scratch_cache_limit) {
+					try {
+						free_blocks[level].push_back(block);
+						cached_bytes += size;
+						return;
+					}
+					catch (...) {}		// 无法记录时直接释放
+				}
+				::operator delete(block);
+			}
+
+			void release() noexcept {
+				for (::std::vector<void*>& blocks : free_blocks) {
+					for (void* const block : blocks) ::operator delete(block);
+					blocks.clear();
+				}
+				cached_bytes = 0;
+			}
+		};
+
+		[[nodiscard]] scratch_pool& local_pool() noexcept {
+			thread_local scratch_pool pool;
+			return pool;
+		}
+	}
+
+	scratch_statistics scratch_stats() noexcept {
+		return local_pool().stats;
+	}
+
+	void reset_scratch_stats() noexcept {
+		local_pool().stats = {};
+	}
+
+	void release_scratch() noexcept {
+		local_pool().release();
+	}
+
+	void* scratch_acquire(const ::std::size_t bytes, unsigned& level) {
+		return local_pool().acquire(bytes, level);
+	}
+
+	void scratch_release(void* const block, const unsigned level) noexcept {
+		local_pool().release(block, level);
+	}
+
+}
@@ -0,0 +1,396 @@
+﻿#include"integer_kernel.h"
+#include<atomic>
+
+// 按位运算与多limb移位的向量化实现: x86-64上有SSE2(基线)与AVX2两档, 运行时按CPU选择;
+// AArch64上使用NEON; 其他平台或定义了C163Q_NO_SIMD时只有逐limb的实现.
+// 向量循环处理不完整的一组后, 剩下的limb都交给逐limb的实现.
+
+#if !defined(C163Q_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define C163Q_SIMD_X86 1
+#include<immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include<intrin.h>
+#endif
+#elif !defined(C163Q_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#define C163Q_SIMD_NEON 1
+#include<arm_neon.h>
+#endif
+
+namespace C163q::kernel {
+
+	namespace {
+		enum class bit_op { and_op, ior_op, xor_op };
+
+		template<bit_op Op>
+		void bitwise_range(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t i, const ::std::size_t n) noexcept {
+			for (; i < n; ++i) {
+				if constexpr (Op == bit_op::and_op) r[i] = a[i] & b[i];
+				else if constexpr (Op == bit_op::ior_op) r[i] = a[i] | b[i];
+				else r[i] = a[i] ^ b[i];
+			}
+		}
+
+		// r[0..n) = a[0..n) << bit的低n个limb, 从高位向低位, 允许r >= a
+		void lshift_range(unit_t* r, const unit_t* a, ::std::size_t n, const unsigned bit) noexcept {
+			for (--n; n; --n) {
+				r[n] = (a[n] << bit) | (a[n - 1] >> (unit_bit - bit));
+			}
+			r[0] = a[0] << bit;
+		}
+
+		// 对[i, n)计算r = a >> bit, a[n - 1]之上视为0, 从低位向高位, 允许r <= a
+		void rshift_range(unit_t* r, const unit_t* a, ::std::size_t i, const ::std::size_t n, const unsigned bit) noexcept {
+			for (; i + 1 < n; ++i) {
+				r[i] = (a[i] >> bit) | (a[i + 1] << (unit_bit - bit));
+			}
+			r[n - 1] = a[n - 1] >> bit;
+		}
+
+		template<bit_op Op>
+		void bitwise_portable(unit_t* r, const unit_t* a, const unit_t* b, const ::std::size_t n) noexcept {
+			bitwise_range<Op>(r, a, b, 0, n);
+		}
+
+		unit_t lshift_portable(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+			const unit_t high = a[n - 1] >> (unit_bit - bit);
+			lshift_range(r, a, n, bit);
+			return high;
+		}
+
+		unit_t rshift_portable(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+			const unit_t low = a[0] << (unit_bit - bit);
+			rshift_range(r, a, 0, n, bit);
+			return low;
+		}
+
+#if defined(C163Q_SIMD_X86)
+		namespace sse2 {
+			constexpr ::std::size_t lanes = 16 / sizeof(unit_t);
+
+			inline __m128i load(const unit_t* p) noexcept {
+				return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			}
+
+			inline void store(unit_t* p, const __m128i v) noexcept {
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+			}
+
+			inline __m128i sll(const __m128i v, const __m128i count) noexcept {
+				if constexpr (unit_bit == 32) return _mm_sll_epi32(v, count);
+				else return _mm_sll_epi64(v, count);
+			}
+
+			inline __m128i srl(const __m128i v, const __m128i count) noexcept {
+				if constexpr (unit_bit == 32) return _mm_srl_epi32(v, count);
+				else return _mm_srl_epi64(v, count);
+			}
+
+			template<bit_op Op>
+			void bitwise(unit_t* r, const unit_t* a, const unit_t* b, const ::std::size_t n) noexcept {
+				::std::size_t i{};
+				for (; i + lanes <= n; i += lanes) {
+					const __m128i x = load(a + i);
+					const __m128i y = load(b + i);
+					if constexpr (Op == bit_op::and_op) store(r + i, _mm_and_si128(x, y));
+					else if constexpr (Op == bit_op::ior_op) store(r + i, _mm_or_si128(x, y));
+					else store(r + i, _mm_xor_si128(x, y));
+				}
+				bitwise_range<Op>(r, a, b, i, n);
+			}
+
+			unit_t lshift(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+				const unit_t high = a[n - 1] >> (unit_bit - bit);
+				const __m128i left = _mm_cvtsi32_si128(static_cast<int>(bit));
+				const __m128i right = _mm_cvtsi32_si128(static_cast<int>(unit_bit - bit));
+				::std::size_t i = n;
+				while (i > lanes) {		// 计算r[i - lanes..i), 需要读取a[i - lanes - 1]
+					i -= lanes;
+					store(r + i, _mm_or_si128(sll(load(a + i), left), srl(load(a + i - 1), right)));
+				}
+				lshift_range(r, a, i, bit);
+				return high;
+			}
+
+			unit_t rshift(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+				const unit_t low = a[0] << (unit_bit - bit);
+				const __m128i right = _mm_cvtsi32_si128(static_cast<int>(bit));
+				const __m128i left = _mm_cvtsi32_si128(static_cast<int>(unit_bit - bit));
+				::std::size_t i{};
+				for (; i + lanes < n; i += lanes) {		// 计算r[i..i + lanes), 需要读取a[i + lanes]
+					store(r + i, _mm_or_si128(srl(load(a + i), right), sll(load(a + i + 1), left)));
+				}
+				rshift_range(r, a, i, n, bit);
+				return low;
+			}
+		}
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+		namespace avx2 {
+			constexpr ::std::size_t lanes = 32 / sizeof(unit_t);
+
+			inline __m256i load(const unit_t* p) noexcept {
+				return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+			}
+
+			inline void store(unit_t* p, const __m256i v) noexcept {
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+			}
+
+			inline __m256i sll(const __m256i v, const __m128i count) noexcept {
+				if constexpr (unit_bit == 32) return _mm256_sll_epi32(v, count);
+				else return _mm256_sll_epi64(v, count);
+			}
+
+			inline __m256i srl(const __m256i v, const __m128i count) noexcept {
+				if constexpr (unit_bit == 32) return _mm256_srl_epi32(v, count);
+				else return _mm256_srl_epi64(v, count);
+			}
+
+			template<bit_op Op>
+			void bitwise(unit_t* r, const unit_t* a, const unit_t* b, const ::std::size_t n) noexcept {
+				::std::size_t i{};
+				for (; i + lanes <= n; i += lanes) {
+					const __m256i x = load(a + i);
+					const __m256i y = load(b + i);
+					if constexpr (Op == bit_op::and_op) store(r + i, _mm256_and_si256(x, y));
+					else if constexpr (Op == bit_op::ior_op) store(r + i, _mm256_or_si256(x, y));
+					else store(r + i, _mm256_xor_si256(x, y));
+				}
+				bitwise_range<Op>(r, a, b, i, n);
+			}
+
+			unit_t lshift(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+				const unit_t high = a[n - 1] >> (unit_bit - bit);
+				const __m128i left = _mm_cvtsi32_si128(static_cast<int>(bit));
+				const __m128i right = _mm_cvtsi32_si128(static_cast<int>(unit_bit - bit));
+				::std::size_t i = n;
+				while (i > lanes) {
+					i -= lanes;
+					store(r + i, _mm256_or_si256(sll(load(a + i), left), srl(load(a + i - 1), right)));
+				}
+				lshift_range(r, a, i, bit);
+				return high;
+			}
+
+			unit_t rshift(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+				const unit_t low = a[0] << (unit_bit - bit);
+				const __m128i right = _mm_cvtsi32_si128(static_cast<int>(bit));
+				const __m128i left = _mm_cvtsi32_si128(static_cast<int>(unit_bit - bit));
+				::std::size_t i{};
+				for (; i + lanes < n; i += lanes) {
+					store(r + i, _mm256_or_si256(srl(load(a + i), right), sll(load(a + i + 1), left)));
+				}
+				rshift_range(r, a, i, n, bit);
+				return low;
+			}
+		}
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+		bool cpu_has_avx2() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7) return false;
+			__cpuid(info, 1);
+			constexpr int osxsave = 1 << 27;
+			constexpr int avx = 1 << 28;
+			if ((info[2] & (osxsave | avx)) != (osxsave | avx)) return false;
+			if ((_xgetbv(0) & 6) != 6) return false;		// 操作系统需保存XMM与YMM寄存器
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+#endif
+
+#if defined(C163Q_SIMD_NEON)
+		namespace neon {
+#if defined(C163Q_INTEGER_UNIT_64)
+			using vector_t = uint64x2_t;
+			using count_t = int64x2_t;
+
+			inline vector_t load(const unit_t* p) noexcept { return vld1q_u64(p); }
+			inline void store(unit_t* p, const vector_t v) noexcept { vst1q_u64(p, v); }
+			inline count_t count(const int bit) noexcept { return vdupq_n_s64(bit); }
+			inline vector_t shl(const vector_t v, const count_t c) noexcept { return vshlq_u64(v, c); }
+			inline vector_t and_v(const vector_t x, const vector_t y) noexcept { return vandq_u64(x, y); }
+			inline vector_t ior_v(const vector_t x, const vector_t y) noexcept { return vorrq_u64(x, y); }
+			inline vector_t xor_v(const vector_t x, const vector_t y) noexcept { return veorq_u64(x, y); }
+#else
+			using vector_t = uint32x4_t;
+			using count_t = int32x4_t;
+
+			inline vector_t load(const unit_t* p) noexcept { return vld1q_u32(p); }
+			inline void store(unit_t* p, const vector_t v) noexcept { vst1q_u32(p, v); }
+			inline count_t count(const int bit) noexcept { return vdupq_n_s32(bit); }
+			inline vector_t shl(const vector_t v, const count_t c) noexcept { return vshlq_u32(v, c); }
+			inline vector_t and_v(const vector_t x, const vector_t y) noexcept { return vandq_u32(x, y); }
+			inline vector_t ior_v(const vector_t x, const vector_t y) noexcept { return vorrq_u32(x, y); }
+			inline vector_t xor_v(const vector_t x, const vector_t y) noexcept { return veorq_u32(x, y); }
+#endif
+			constexpr ::std::size_t lanes = 16 / sizeof(unit_t);
+
+			template<bit_op Op>
+			void bitwise(unit_t* r, const unit_t* a, const unit_t* b, const ::std::size_t n) noexcept {
+				::std::size_t i{};
+				for (; i + lanes <= n; i += lanes) {
+					const vector_t x = load(a + i);
+					const vector_t y = load(b + i);
+					if constexpr (Op == bit_op::and_op) store(r + i, and_v(x, y));
+					else if constexpr (Op == bit_op::ior_op) store(r + i, ior_v(x, y));
+					else store(r + i, xor_v(x, y));
+				}
+				bitwise_range<Op>(r, a, b, i, n);
+			}
+
+			// vshlq的移位量为负数时右移
+			unit_t lshift(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+				const unit_t high = a[n - 1] >> (unit_bit - bit);
+				const count_t left = count(static_cast<int>(bit));
+				const count_t right = count(-static_cast<int>(unit_bit - bit));
+				::std::size_t i = n;
+				while (i > lanes) {
+					i -= lanes;
+					store(r + i, ior_v(shl(load(a + i), left), shl(load(a + i - 1), right)));
+				}
+				lshift_range(r, a, i, bit);
+				return high;
+			}
+
+			unit_t rshift(unit_t* r, const unit_t* a, const ::std::size_t n, const unsigned bit) noexcept {
+				const unit_t low = a[0] << (unit_bit - bit);
+				const count_t right = count(-static_cast<int>(bit));
+				const count_t left = count(static_cast<int>(unit_bit - bit));
+				::std::size_t i{};
+				for (; i + lanes < n; i += lanes) {
+					store(r + i, ior_v(shl(load(a + i), right), shl(load(a + i + 1), left)));
+				}
+				rshift_range(r, a, i, n, bit);
+				return low;
+			}
+		}
+#endif
+
+		struct simd_table {
+			simd_isa isa;
+			void (*and_n)(unit_t*, const unit_t*, const unit_t*, ::std::size_t) noexcept;
+			void (*ior_n)(unit_t*, const unit_t*, const unit_t*, ::std::size_t) noexcept;
+			void (*xor_n)(unit_t*, const unit_t*, const unit_t*, ::std::size_t) noexcept;
+			unit_t(*lshift)(unit_t*, const unit_t*, ::std::size_t, unsigned) noexcept;
+			unit_t(*rshift)(unit_t*, const unit_t*, ::std::size_t, unsigned) noexcept;
+		};
+
+		constexpr simd_table portable_table{
+			simd_isa::portable,
+			bitwise_portable<bit_op::and_op>, bitwise_portable<bit_op::ior_op>, bitwise_portable<bit_op::xor_op>,
+			lshift_portable, rshift_portable
+		};
+
+#if defined(C163Q_SIMD_X86)
+		constexpr simd_table sse2_table{
+			simd_isa::sse2,
+			sse2::bitwise<bit_op::and_op>, sse2::bitwise<bit_op::ior_op>, sse2::bitwise<bit_op::xor_op>,
+			sse2::lshift, sse2::rshift
+		};
+
+		constexpr simd_table avx2_table{
+			simd_isa::avx2,
+			avx2::bitwise<bit_op::and_op>, avx2::bitwise<bit_op::ior_op>, avx2::bitwise<bit_op::xor_op>,
+			avx2::lshift, avx2::rshift
+		};
+#endif
+
+#if defined(C163Q_SIMD_NEON)
+		constexpr simd_table neon_table{
+			simd_isa::neon,
+			neon::bitwise<bit_op::and_op>, neon::bitwise<bit_op::ior_op>, neon::bitwise<bit_op::xor_op>,
+			neon::lshift, neon::rshift
+		};
+#endif
+
+		[[nodiscard]] const simd_table* table_of(const simd_isa isa) noexcept {
+			switch (isa) {
+#if defined(C163Q_SIMD_X86)
+			case simd_isa::sse2:
+				return &sse2_table;
+			case simd_isa::avx2:
+				return cpu_has_avx2() ? &avx2_table : nullptr;
+#endif
+#if defined(C163Q_SIMD_NEON)
+			case simd_isa::neon:
+				return &neon_table;
+#endif
+			case simd_isa::portable:
+				return &portable_table;
+			default:
+				return nullptr;
+			}
+		}
+
+		[[nodiscard]] const simd_table* detect() noexcept {
+#if defined(C163Q_SIMD_X86)
+			return cpu_has_avx2() ? &avx2_table : &sse2_table;
+#elif defined(C163Q_SIMD_NEON)
+			return &neon_table;
+#else
+			return &portable_table;
+#endif
+		}
+
+		[[nodiscard]] ::std::atomic<const simd_table*>& active() noexcept {
+			static ::std::atomic<const simd_table*> table{ detect() };
+			return table;
+		}
+
+		[[nodiscard]] const simd_table& current() noexcept {
+			return *active().load(::std::memory_order_relaxed);
+		}
+	}
+
+	[[nodiscard]] simd_isa simd_support() noexcept {
+		return detect()->isa;
+	}
+
+	[[nodiscard]] simd_isa simd_level() noexcept {
+		return current().isa;
+	}
+
+	bool set_simd_level(const simd_isa isa) noexcept {
+		const simd_table* const table = table_of(isa);
+		if (!table) return false;
+		active().store(table, ::std::memory_order_relaxed);
+		return true;
+	}
+
+	void and_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept {
+		current().and_n(r, a, b, n);
+	}
+
+	void ior_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept {
+		current().ior_n(r, a, b, n);
+	}
+
+	void xor_n(unit_t* r, const unit_t* a, const unit_t* b, ::std::size_t n) noexcept {
+		current().xor_n(r, a, b, n);
+	}
+
+	unit_t lshift(unit_t* r, const unit_t* a, ::std::size_t n, unsigned bit) noexcept {
+		return current().lshift(r, a, n, bit);
+	}
+
+	unit_t rshift(unit_t* r, const unit_t* a, ::std::size_t n, unsigned bit) noexcept {
+		return current().rshift(r, a, n, bit);
+	}
+
+}
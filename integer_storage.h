@@ -0,0 +1,388 @@
+﻿#pragma once
+#include<algorithm>
+#include<cstddef>
+#include<cstring>
+#include<initializer_list>
+#include<iterator>
+#include<memory>
+#include<memory_resource>
+#include<stdexcept>
+#include<type_traits>
+#include<utility>
+
+
+namespace C163q {
+	class resource_scope;
+
+	/// @brief 当前线程中新建的`small_vector`(从而`integer`)所使用的内存资源.
+	/// 可以用`resource_scope`指定任意`::std::pmr::memory_resource`, 或用`scoped_arena`开启一个内存池.
+	class storage_resource {
+		friend resource_scope;
+
+	private:
+		inline static thread_local ::std::pmr::memory_resource* scoped = nullptr;
+
+	public:
+		// 没有`resource_scope`生效时为nullptr, 表示直接使用全局的`operator new`
+		[[nodiscard]] static ::std::pmr::memory_resource* current() noexcept {
+			return scoped;
+		}
+	};
+
+	/// @brief 在作用域内把当前线程的`storage_resource::current()`设为指定的资源, 析构时恢复. 可以嵌套.
+	class resource_scope {
+	private:
+		::std::pmr::memory_resource* previous;
+
+	public:
+		explicit resource_scope(::std::pmr::memory_resource* resource) noexcept : previous(storage_resource::scoped) {
+			storage_resource::scoped = resource;
+		}
+
+		resource_scope(const resource_scope&) = delete;
+		resource_scope& operator=(const resource_scope&) = delete;
+
+		~resource_scope() {
+			storage_resource::scoped = previous;
+		}
+	};
+
+	/// @brief 作用域内的内存池: 期间在当前线程新建的整数都从一块单调增长的缓冲区分配, 析构时一次性释放.
+	/// 适合一批只在作用域内使用的中间结果, 同时避免多线程争用全局堆.
+	/// @note 与`::std::pmr`容器相同, 对象在构造时确定内存资源: 赋值给作用域外构造的对象会复制到该对象的资源上,
+	/// 但在作用域内构造的对象(包括移动构造出的对象)不能在作用域结束后继续使用.
+	class scoped_arena {
+	private:
+		::std::pmr::monotonic_buffer_resource arena;
+		resource_scope scope;
+
+	public:
+		explicit scoped_arena(const ::std::size_t initial_size = 64 * 1024) : arena(initial_size), scope(&arena) {}
+
+		// 先使用调用方提供的缓冲区, 用完后再向上游申请
+		scoped_arena(void* buffer, const ::std::size_t size) : arena(buffer, size), scope(&arena) {}
+
+		[[nodiscard]] ::std::pmr::memory_resource* resource() noexcept {
+			return &arena;
+		}
+	};
+
+	/// @brief 带内联缓冲区的连续容器, 接口与`::std::vector`的常用部分一致.
+	/// 元素个数不超过N时直接存放在对象内部, 超过后才从构造时的`storage_resource::current()`(默认为全局堆)分配,
+	/// 使绝大多数小整数不需要分配内存.
+	/// @note 只用于可平凡复制的元素类型(limb), 移动内联存储的对象时会复制元素.
+	template<class T, ::std::size_t N>
+	class small_vector {
+		static_assert(::std::is_trivially_copyable_v<T>, "small_vector only stores trivially copyable types");
+		static_assert(N > 0, "small_vector needs at least one inline element");
+
+	public:
+		using value_type = T;
+		using size_type = ::std::size_t;
+		using difference_type = ::std::ptrdiff_t;
+		using reference = T&;
+		using const_reference = const T&;
+		using pointer = T*;
+		using const_pointer = const T*;
+		using iterator = T*;
+		using const_iterator = const T*;
+		using reverse_iterator = ::std::reverse_iterator<iterator>;
+		using const_reverse_iterator = ::std::reverse_iterator<const_iterator>;
+
+		constexpr static size_type inline_capacity = N;
+
+	private:
+		T* ptr;				// 指向local或堆上的存储
+		size_type count;
+		size_type cap;
+		::std::pmr::memory_resource* resource;		// 构造后不再改变, nullptr表示全局堆
+		T local[N];
+
+	public:
+		small_vector() noexcept : ptr(local), count(), cap(N), resource(storage_resource::current()) {}
+
+		// count个值初始化(即为0)的元素
+		explicit small_vector(const size_type n) : small_vector() {
+			resize(n);
+		}
+
+		small_vector(const size_type n, const T& value) : small_vector() {
+			resize(n, value);
+		}
+
+		small_vector(::std::initializer_list<T> init) : small_vector(init.begin(), init.end()) {}
+
+		template<class InputIt, class = ::std::enable_if_t<!::std::is_integral_v<InputIt>>>
+		small_vector(InputIt first, InputIt last) : small_vector() {
+			insert(end(), first, last);
+		}
+
+		small_vector(const small_vector& other) : small_vector() {
+			reserve(other.count);
+			copy_elements(ptr, other.ptr, other.count);
+			count = other.count;
+		}
+
+		// 沿用other的内存资源
+		small_vector(small_vector&& other) noexcept : ptr(local), count(), cap(N), resource(other.resource) {
+			steal(other);
+		}
+
+		~small_vector() {
+			release();
+		}
+
+		small_vector& operator=(const small_vector& other) {
+			if (this == ::std::addressof(other)) return *this;
+			count = 0;
+			reserve(other.count);
+			copy_elements(ptr, other.ptr, other.count);
+			count = other.count;
+			return *this;
+		}
+
+		// 内存资源不同时复制元素, 使*this始终只持有来自自身资源的存储
+		small_vector& operator=(small_vector&& other) {
+			if (this == ::std::addressof(other)) return *this;
+			if (!other.is_inline() && !same_resource(other)) return operator=(other);
+			release();
+			ptr = local;
+			count = 0;
+			cap = N;
+			steal(other);
+			return *this;
+		}
+
+		small_vector& operator=(::std::initializer_list<T> init) {
+			assign(init.begin(), init.end());
+			return *this;
+		}
+
+		template<class InputIt, class = ::std::enable_if_t<!::std::is_integral_v<InputIt>>>
+		void assign(InputIt first, InputIt last) {
+			clear();
+			insert(end(), first, last);
+		}
+
+		void assign(const size_type n, const T& value) {
+			clear();
+			resize(n, value);
+		}
+
+		[[nodiscard]] iterator begin() noexcept { return ptr; }
+		[[nodiscard]] const_iterator begin() const noexcept { return ptr; }
+		[[nodiscard]] const_iterator cbegin() const noexcept { return ptr; }
+		[[nodiscard]] iterator end() noexcept { return ptr + count; }
+		[[nodiscard]] const_iterator end() const noexcept { return ptr + count; }
+		[[nodiscard]] const_iterator cend() const noexcept { return ptr + count; }
+		[[nodiscard]] reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+		[[nodiscard]] const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+		[[nodiscard]] const_reverse_iterator crbegin() const noexcept { return const_reverse_iterator(end()); }
+		[[nodiscard]] reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+		[[nodiscard]] const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+		[[nodiscard]] const_reverse_iterator crend() const noexcept { return const_reverse_iterator(begin()); }
+
+		[[nodiscard]] size_type size() const noexcept { return count; }
+		[[nodiscard]] size_type capacity() const noexcept { return cap; }
+		[[nodiscard]] bool empty() const noexcept { return !count; }
+
+		// 存储是否位于对象内部(未分配堆内存)
+		[[nodiscard]] bool is_inline() const noexcept { return ptr == local; }
+
+		[[nodiscard]] ::std::pmr::memory_resource* get_resource() const noexcept { return resource; }
+
+		[[nodiscard]] T* data() noexcept { return ptr; }
+		[[nodiscard]] const T* data() const noexcept { return ptr; }
+
+		[[nodiscard]] reference operator[](const size_type i) noexcept { return ptr[i]; }
+		[[nodiscard]] const_reference operator[](const size_type i) const noexcept { return ptr[i]; }
+
+		[[nodiscard]] reference at(const size_type i) {
+			if (i >= count) throw ::std::out_of_range("small_vector::at");
+			return ptr[i];
+		}
+
+		[[nodiscard]] const_reference at(const size_type i) const {
+			if (i >= count) throw ::std::out_of_range("small_vector::at");
+			return ptr[i];
+		}
+
+		[[nodiscard]] reference front() noexcept { return ptr[0]; }
+		[[nodiscard]] const_reference front() const noexcept { return ptr[0]; }
+		[[nodiscard]] reference back() noexcept { return ptr[count - 1]; }
+		[[nodiscard]] const_reference back() const noexcept { return ptr[count - 1]; }
+
+		void reserve(const size_type n) {
+			if (n > cap) reallocate(n);
+		}
+
+		void shrink_to_fit() {
+			if (is_inline() || count == cap) return;
+			if (count <= N) {
+				T* const old = ptr;
+				const size_type old_cap = cap;
+				copy_elements(local, old, count);
+				ptr = local;
+				cap = N;
+				deallocate(old, old_cap);
+			}
+			else {
+				reallocate(count);
+			}
+		}
+
+		void clear() noexcept {
+			count = 0;
+		}
+
+		void resize(const size_type n) {
+			resize(n, T{});
+		}
+
+		void resize(const size_type n, const T& value) {
+			if (n > count) {
+				grow_for(n);
+				::std::fill(ptr + count, ptr + n, value);
+			}
+			count = n;
+		}
+
+		void push_back(const T& value) {
+			if (count == cap) {
+				const T copy = value;		// value可能位于即将释放的存储中
+				grow_for(count + 1);
+				ptr[count++] = copy;
+				return;
+			}
+			ptr[count++] = value;
+		}
+
+		template<class... Args>
+		reference emplace_back(Args&&... args) {
+			push_back(T(::std::forward<Args>(args)...));
+			return back();
+		}
+
+		void pop_back() noexcept {
+			--count;
+		}
+
+		iterator insert(const_iterator pos, const T& value) {
+			return insert(pos, 1, value);
+		}
+
+		iterator insert(const_iterator pos, const size_type n, const T& value) {
+			const size_type index = static_cast<size_type>(pos - ptr);
+			const T copy = value;
+			open_gap(index, n);
+			::std::fill(ptr + index, ptr + index + n, copy);
+			return ptr + index;
+		}
+
+		// Note: 与`::std::vector`相同, [first, last)不能是自身的元素
+		template<class InputIt, class = ::std::enable_if_t<!::std::is_integral_v<InputIt>>>
+		iterator insert(const_iterator pos, InputIt first, InputIt last) {
+			const size_type index = static_cast<size_type>(pos - ptr);
+			if constexpr (::std::is_base_of_v<::std::forward_iterator_tag, typename ::std::iterator_traits<InputIt>::iterator_category>) {
+				const size_type n = static_cast<size_type>(::std::distance(first, last));
+				open_gap(index, n);
+				::std::copy(first, last, ptr + index);
+			}
+			else {
+				for (size_type i = index; first != last; ++first, ++i) {
+					insert(ptr + i, static_cast<T>(*first));
+				}
+			}
+			return ptr + index;
+		}
+
+		iterator erase(const_iterator pos) {
+			return erase(pos, pos + 1);
+		}
+
+		iterator erase(const_iterator first, const_iterator last) {
+			const size_type index = static_cast<size_type>(first - ptr);
+			const size_type n = static_cast<size_type>(last - first);
+			if (n) {
+				::std::memmove(ptr + index, ptr + index + n, (count - index - n) * sizeof(T));
+				count -= n;
+			}
+			return ptr + index;
+		}
+
+		void swap(small_vector& other) {
+			small_vector tmp(::std::move(other));
+			other = ::std::move(*this);
+			*this = ::std::move(tmp);
+		}
+
+		[[nodiscard]] bool operator==(const small_vector& other) const noexcept {
+			return count == other.count && ::std::equal(ptr, ptr + count, other.ptr);
+		}
+
+		[[nodiscard]] bool operator!=(const small_vector& other) const noexcept {
+			return !operator==(other);
+		}
+
+	private:
+		[[nodiscard]] T* allocate(const size_type n) {
+			if (!resource) return ::std::allocator<T>().allocate(n);
+			return static_cast<T*>(resource->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T* p, const size_type n) noexcept {
+			if (!resource) ::std::allocator<T>().deallocate(p, n);
+			else resource->deallocate(p, n * sizeof(T), alignof(T));
+		}
+
+		[[nodiscard]] bool same_resource(const small_vector& other) const noexcept {
+			if (resource == other.resource) return true;
+			return resource && other.resource && *resource == *other.resource;
+		}
+
+		static void copy_elements(T* dst, const T* src, const size_type n) noexcept {
+			if (n) ::std::memcpy(dst, src, n * sizeof(T));
+		}
+
+		void release() noexcept {
+			if (!is_inline()) deallocate(ptr, cap);
+		}
+
+		// 改为在容量为new_cap的新存储上保存现有元素. Note: new_cap >= count
+		void reallocate(const size_type new_cap) {
+			T* const fresh = allocate(new_cap);
+			copy_elements(fresh, ptr, count);
+			release();
+			ptr = fresh;
+			cap = new_cap;
+		}
+
+		// 保证能容纳n个元素, 按倍增策略扩容以摊还push_back的代价
+		void grow_for(const size_type n) {
+			if (n > cap) reallocate(::std::max(n, 2 * cap));
+		}
+
+		// 在index处空出n个元素的位置(内容未指定)
+		void open_gap(const size_type index, const size_type n) {
+			grow_for(count + n);
+			::std::memmove(ptr + index + n, ptr + index, (count - index) * sizeof(T));
+			count += n;
+		}
+
+		// 接管other的存储, other变为空. Note: *this为空且使用内联存储, other使用堆存储时两者的资源相同
+		void steal(small_vector& other) noexcept {
+			if (other.is_inline()) {
+				copy_elements(local, other.local, other.count);
+			}
+			else {
+				ptr = other.ptr;
+				cap = other.cap;
+				other.ptr = other.local;
+				other.cap = N;
+			}
+			count = other.count;
+			other.count = 0;
+		}
+	};
+
+}
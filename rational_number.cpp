@@ -1,4 +1,6 @@
 ﻿#include "rational_number.h"
+#include<algorithm>
+#include<string_view>
 
 
 namespace C163q {
@@ -23,4 +25,77 @@ namespace C163q {
 		reduction();
 	}
 
+	namespace {
+		// 把字面量text写入[first, last)
+		::std::to_chars_result write_literal(char* first, char* last, const ::std::string_view text) noexcept {
+			if (static_cast<size_t>(last - first) < text.size()) return { last, ::std::errc::value_too_large };
+			return { ::std::copy(text.begin(), text.end(), first), ::std::errc{} };
+		}
+
+		// [first, last)以text开头(不区分大小写)时返回true
+		[[nodiscard]] bool starts_with_literal(const char* first, const char* last, const ::std::string_view text) noexcept {
+			if (static_cast<size_t>(last - first) < text.size()) return false;
+			return ::std::equal(text.begin(), text.end(), first, [](const char a, const char b) { return a == b || a == (b | 0x20); });
+		}
+
+		// 从24进制起'i', 'n', 'f', 'a'都是合法数字, 这时无穷与NaN改用'@'包围的形式, 以免与整数混淆
+		[[nodiscard]] bool bare_literal_allowed(const int base) noexcept {
+			return base < 24;
+		}
+	}
+
+	[[nodiscard]] ::std::size_t to_chars_length(const rational_number& value, const int base) noexcept {
+		if (value.is_NaN() || value.is_infinity()) return bare_literal_allowed(base) ? 4 : 6;
+		return to_chars_length(value.numerator, base) + 1 + to_chars_length(value.denominator, base);
+	}
+
+	::std::to_chars_result to_chars(char* first, char* last, const rational_number& value, const int base) {
+		const bool bare = bare_literal_allowed(base);
+		if (value.is_NaN()) return write_literal(first, last, bare ? "nan" : "@nan@");
+		if (value.is_infinity()) {
+			if (value.numerator.is_negative()) return write_literal(first, last, bare ? "-inf" : "-@inf@");
+			return write_literal(first, last, bare ? "inf" : "@inf@");
+		}
+		::std::to_chars_result ret = to_chars(first, last, value.numerator, base);
+		if (ret.ec != ::std::errc{} || value.denominator.is_one()) return ret;
+		if (ret.ptr == last) return { last, ::std::errc::value_too_large };
+		*ret.ptr++ = '/';
+		return to_chars(ret.ptr, last, value.denominator, base);
+	}
+
+	::std::from_chars_result from_chars(const char* first, const char* last, rational_number& value, const int base) {
+		const bool neg = first != last && *first == '-';
+		// '@'形式在任何进制下都接受, 不带'@'的字面量只在其字母不是数字时接受
+		if (starts_with_literal(first, last, "@nan@")) {
+			value = rational_number::NaN();
+			return { first + 5, ::std::errc{} };
+		}
+		if (starts_with_literal(first + neg, last, "@inf@")) {
+			value = neg ? rational_number::negative_inf() : rational_number::positive_inf();
+			return { first + neg + 5, ::std::errc{} };
+		}
+		if (bare_literal_allowed(base)) {
+			if (starts_with_literal(first, last, "nan")) {
+				value = rational_number::NaN();
+				return { first + 3, ::std::errc{} };
+			}
+			if (starts_with_literal(first + neg, last, "inf")) {
+				value = neg ? rational_number::negative_inf() : rational_number::positive_inf();
+				return { first + neg + 3, ::std::errc{} };
+			}
+		}
+		integer numerator;
+		::std::from_chars_result ret = from_chars(first, last, numerator, base);
+		if (ret.ec != ::std::errc{}) return ret;
+		integer denominator(1U);
+		if (ret.ptr != last && *ret.ptr == '/') {
+			const ::std::from_chars_result den = from_chars(ret.ptr + 1, last, denominator, base);
+			// 分母不能带符号
+			if (den.ec == ::std::errc{} && ret.ptr[1] != '-') ret.ptr = den.ptr;
+			else denominator = 1U;
+		}
+		value = rational_number(::std::move(numerator), ::std::move(denominator));
+		return ret;
+	}
+
 }
@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include"integer.h"
+#include"integer_expr.h"
 #include<ratio>
 
 
@@ -82,9 +83,9 @@ namespace C163q {
 		[[nodiscard]] rational_number operator+(const rational_number& rhs) const {
 			if (is_NaN() || rhs.is_NaN() || is_infinity() || rhs.is_infinity()) return NaN();
 			integer lcm_res(lcm(denominator, rhs.denominator));
-			integer lhs_num(lcm_res / denominator * numerator);
-			integer rhs_num(lcm_res / rhs.denominator * rhs.numerator);
-			rational_number ret(lhs_num + rhs_num, ::std::move(lcm_res));
+			// 右侧的乘积直接累加到分子上
+			integer num = expr::lazy(lcm_res) / denominator * numerator + expr::lazy(lcm_res) / rhs.denominator * rhs.numerator;
+			rational_number ret(::std::move(num), ::std::move(lcm_res));
 			ret.normalize();
 			return ret;
 		}
@@ -96,9 +97,9 @@ namespace C163q {
 		[[nodiscard]] rational_number operator-(const rational_number& rhs) const {
 			if (is_NaN() || rhs.is_NaN() || is_infinity() || rhs.is_infinity()) return NaN();
 			integer lcm_res(lcm(denominator, rhs.denominator));
-			integer lhs_num(lcm_res / denominator * numerator);
-			integer rhs_num(lcm_res / rhs.denominator * rhs.numerator);
-			rational_number ret(lhs_num - rhs_num, ::std::move(lcm_res));
+			// 右侧的乘积直接累加到分子上
+			integer num = expr::lazy(lcm_res) / denominator * numerator - expr::lazy(lcm_res) / rhs.denominator * rhs.numerator;
+			rational_number ret(::std::move(num), ::std::move(lcm_res));
 			ret.normalize();
 			return ret;
 		}
@@ -113,7 +114,7 @@ namespace C163q {
 
 		[[nodiscard]] bool operator>(const rational_number& rhs) const noexcept {
 			if (is_NaN() || rhs.is_NaN() || is_negative_inf() || rhs.is_positive_inf()) return false;
-			if ((is_positive_inf() && !rhs.is_positive_inf()) || (rhs.is_negative_inf() && !is_negative_inf)) return true;
+			if ((is_positive_inf() && !rhs.is_positive_inf()) || (rhs.is_negative_inf() && !is_negative_inf())) return true;
 			if (is_infinity() || rhs.is_infinity()) return false;
 			integer lcm_res(lcm(denominator, rhs.denominator));
 			integer lhs_num(lcm_res / denominator * numerator);
@@ -123,7 +124,7 @@ namespace C163q {
 
 		[[nodiscard]] bool operator<(const rational_number& rhs) const noexcept {
 			if (is_NaN() || rhs.is_NaN() || is_positive_inf() || rhs.is_negative_inf()) return false;
-			if ((is_negative_inf() && !rhs.is_negative_inf()) || (rhs.is_positive_inf() && !is_positive_inf)) return true;
+			if ((is_negative_inf() && !rhs.is_negative_inf()) || (rhs.is_positive_inf() && !is_positive_inf())) return true;
 			if (is_infinity() || rhs.is_infinity()) return false;
 			integer lcm_res(lcm(denominator, rhs.denominator));
 			integer lhs_num(lcm_res / denominator * numerator);
@@ -141,14 +142,14 @@ namespace C163q {
 
 		[[nodiscard]] bool operator<=(const rational_number& rhs) const noexcept {
 			if (is_NaN() || rhs.is_NaN() || is_positive_inf() || rhs.is_negative_inf()) return false;
-			if ((is_negative_inf() && !rhs.is_negative_inf()) || (rhs.is_positive_inf() && !is_positive_inf)) return true;
+			if ((is_negative_inf() && !rhs.is_negative_inf()) || (rhs.is_positive_inf() && !is_positive_inf())) return true;
 			if (is_infinity() || rhs.is_infinity()) return false;
 			return !operator>(rhs);
 		}
 
 		[[nodiscard]] bool operator>=(const rational_number& rhs) const noexcept {
 			if (is_NaN() || rhs.is_NaN() || is_negative_inf() || rhs.is_positive_inf()) return false;
-			if ((is_positive_inf() && !rhs.is_positive_inf()) || (rhs.is_negative_inf() && !is_negative_inf)) return true;
+			if ((is_positive_inf() && !rhs.is_positive_inf()) || (rhs.is_negative_inf() && !is_negative_inf())) return true;
 			if (is_infinity() || rhs.is_infinity()) return false;
 			return !operator<(rhs);
 		}
@@ -199,8 +200,25 @@ namespace C163q {
 
 		void normalize();
 
-		
+		friend ::std::size_t to_chars_length(const rational_number& value, int base) noexcept;
+
+		friend ::std::to_chars_result to_chars(char* first, char* last, const rational_number& value, int base);
+
+		friend ::std::from_chars_result from_chars(const char* first, const char* last, rational_number& value, int base);
 
 	};
 
+	// 以base进制写出value所需字符数的上界. 格式见`to_chars`. Note: 2 <= base <= 36
+	[[nodiscard]] ::std::size_t to_chars_length(const rational_number& value, int base = 10) noexcept;
+
+	// 同`::std::to_chars`, 写出"分子/分母"; 分母为1时只写分子, 无穷与NaN分别写为"inf", "-inf"与"nan".
+	// base >= 24时这些字母都是合法数字(eg. 36进制的"nan"是30191), 此时改写为"@inf@", "-@inf@"与"@nan@".
+	// 空间不足时返回{ last, value_too_large }. Note: 2 <= base <= 36
+	::std::to_chars_result to_chars(char* first, char* last, const rational_number& value, int base = 10);
+
+	// 同`::std::from_chars`, 接受`to_chars`写出的格式, '/'后不是数字时只解析分子. 结果会被约分.
+	// "@inf@"与"@nan@"在任何进制下都接受, 不带'@'的"inf"与"nan"只在base < 24时接受(不区分大小写).
+	// 无法解析时返回{ first, invalid_argument }且value不变. Note: 2 <= base <= 36
+	::std::from_chars_result from_chars(const char* first, const char* last, rational_number& value, int base = 10);
+
 }
\ No newline at end of file
@@ -0,0 +1,171 @@
+﻿#include<cstddef>
+#include<cstdint>
+#include<cstdio>
+#include<random>
+#include<string>
+#include<tuple>
+#include<vector>
+#include"integer.h"
+#include"integer_kernel.h"
+#include"integer_modular.h"
+
+// 差分检查: 调低`kernel`中的切换阈值, 使只在大规模下才会运行的算法在几百个limb内就被用到,
+// 再与基础实现(逐行乘法等)的结果比较. 与main.cpp一样单独编译, 全部一致时返回0. eg.
+//   g++ -std=c++20 -O2 threshold_check.cpp integer*.cpp -o threshold_check
+// (32位单元时与main.cpp相同, 需要编译器提供`__int32`/`__int64`)
+
+namespace {
+	using C163q::integer;
+	using C163q::kernel::unit_t;
+
+	::std::mt19937_64 rng(20261017);
+	::std::size_t failures{};
+
+	void check(const bool ok, const char* what, const ::std::size_t limbs) {
+		if (ok) return;
+		++failures;
+		::std::printf("FAIL: %s (%zu limbs)\n", what, limbs);
+		::std::fflush(stdout);		// 之后的检查可能崩溃
+	}
+
+	/// @brief 在作用域内把阈值改为value, 离开时恢复
+	class threshold_guard {
+	private:
+		::std::size_t& threshold;
+		::std::size_t saved;
+
+	public:
+		threshold_guard(::std::size_t& threshold, const ::std::size_t value) noexcept : threshold(threshold), saved(threshold) {
+			threshold = value;
+		}
+
+		~threshold_guard() {
+			threshold = saved;
+		}
+
+		threshold_guard(const threshold_guard&) = delete;
+		threshold_guard& operator=(const threshold_guard&) = delete;
+	};
+
+	// n个随机limb, 最高limb非0
+	[[nodiscard]] ::std::vector<unit_t> random_limbs(const ::std::size_t n) {
+		::std::vector<unit_t> ret(n);
+		for (unit_t& x : ret) x = static_cast<unit_t>(rng());
+		if (!ret.back()) ret.back() = 1;
+		return ret;
+	}
+
+	// 约limbs个limb的随机数. 偶尔取全1的limb, 以覆盖进位与商的估计值需要修正的情况
+	[[nodiscard]] integer random_integer(const ::std::size_t limbs) {
+		const bool ones = rng() % 8 == 0;
+		::std::string hex;
+		for (::std::size_t i{}; i < limbs * C163q::kernel::unit_bit / 4; ++i) {
+			hex.push_back(ones ? 'f' : "0123456789abcdef"[rng() % 16]);
+		}
+		if (hex.front() == '0') hex.front() = '1';
+		return integer(hex, 16);
+	}
+
+	// NTT乘法与平方 vs 逐行乘法
+	void check_ntt() {
+		const threshold_guard mul_guard(C163q::kernel::mul_ntt_threshold, 16);
+		const threshold_guard sqr_guard(C163q::kernel::sqr_ntt_threshold, 16);
+		for (int i{}; i < 200; ++i) {
+			const ::std::size_t an = 16 + rng() % 300;
+			const ::std::size_t bn = 16 + rng() % (an - 15);
+			const ::std::vector<unit_t> a = random_limbs(an);
+			const ::std::vector<unit_t> b = random_limbs(bn);
+			::std::vector<unit_t> expect(an + bn), got(an + bn);
+			C163q::kernel::mul_basecase(expect.data(), a.data(), an, b.data(), bn);
+			C163q::kernel::mul(got.data(), a.data(), an, b.data(), bn);
+			check(expect == got, "mul (NTT)", an);
+			expect.assign(2 * an, 0);
+			got.assign(2 * an, 0);
+			C163q::kernel::sqr_basecase(expect.data(), a.data(), an);
+			C163q::kernel::sqr(got.data(), a.data(), an);
+			check(expect == got, "sqr (NTT)", an);
+		}
+	}
+
+	// Burnikel-Ziegler分治除法 vs 算法D, 并验证a == q * d + r, 0 <= r < d
+	void check_division() {
+		for (int i{}; i < 300; ++i) {
+			const ::std::size_t dn = 2 + rng() % 200;
+			const integer d = random_integer(dn);
+			integer a = random_integer(dn + rng() % 300);
+			if (i % 4 == 0) {
+				// 商全为1时部分余数的高位与除数相同, 覆盖商取B^k - 1的分支
+				a = d * ((integer(1) << (C163q::kernel::unit_bit * (1 + rng() % 200))) - integer(1)) + random_integer(dn - 1);
+			}
+			integer q_expect, r_expect;
+			{
+				const threshold_guard guard(C163q::kernel::div_dc_threshold, SIZE_MAX);
+				q_expect = a / d;
+				r_expect = a % d;
+			}
+			const threshold_guard guard(C163q::kernel::div_dc_threshold, 2 + rng() % 8);
+			const integer q = a / d;
+			const integer r = a % d;
+			check(q == q_expect && r == r_expect, "divrem (Burnikel-Ziegler)", dn);
+			check(q * d + r == a && !r.is_negative() && r < d, "divrem identity", dn);
+		}
+	}
+
+	// 半GCD vs 只用Lehmer算法. xgcd的系数与逐步Euclid算法的相同, 所以两边的结果应完全一致
+	void check_gcd() {
+		for (int i{}; i < 150; ++i) {
+			const ::std::size_t n = 1 + rng() % 150;
+			integer a = random_integer(n);
+			integer b = random_integer(1 + rng() % n);
+			if (i % 3 == 0) {
+				const integer g = random_integer(1 + rng() % 20);
+				a *= g;
+				b *= g;
+			}
+			if (rng() % 2) a = integer(0) - a;
+			if (rng() % 2) b = integer(0) - b;
+			integer g_expect;
+			::std::tuple<integer, integer, integer> x_expect;
+			{
+				const threshold_guard guard(C163q::kernel::gcd_dc_threshold, SIZE_MAX);
+				g_expect = gcd(a, b);
+				x_expect = xgcd(a, b);
+			}
+			const threshold_guard dc_guard(C163q::kernel::gcd_dc_threshold, 3 + rng() % 8);
+			const threshold_guard basecase_guard(C163q::kernel::hgcd_basecase_threshold, 1 + rng() % 4);
+			check(gcd(a, b) == g_expect, "gcd (half-GCD)", n);
+			const auto [g, x, y] = xgcd(a, b);
+			check(g == ::std::get<0>(x_expect) && x == ::std::get<1>(x_expect) && y == ::std::get<2>(x_expect), "xgcd (half-GCD)", n);
+			check(g == g_expect && a * x + b * y == g, "xgcd identity", n);
+		}
+	}
+
+	// Montgomery整块约化(两次整块乘法) vs integer的乘法与取模
+	void check_redc() {
+		for (int i{}; i < 150; ++i) {
+			const ::std::size_t n = 2 + rng() % 120;
+			const integer m = random_integer(n) | integer(1);
+			const integer a = random_integer(1 + rng() % n) % m;
+			const integer b = random_integer(1 + rng() % n) % m;
+			// 阈值在构造时决定是否预先求出n limb的-m^-1 mod R, 所以要在构造前调低
+			const threshold_guard guard(C163q::kernel::redc_dc_threshold, 2 + rng() % 5);
+			const C163q::modular_context ctx(m);
+			const auto ra = ctx.to_residue(a);
+			const auto rb = ctx.to_residue(b);
+			auto r = ctx.zero();
+			ctx.mulmod(r, ra, rb);
+			check(ctx.to_integer(r) == a * b % m, "mulmod (DC-REDC)", n);
+			ctx.sqrmod(r, ra);
+			check(ctx.to_integer(r) == a.square() % m, "sqrmod (DC-REDC)", n);
+		}
+	}
+}
+
+int main() {
+	check_ntt();
+	check_division();
+	check_gcd();
+	check_redc();
+	::std::printf("%zu failure(s)\n", failures);
+	return failures ? 1 : 0;
+}